@@ -4,49 +4,460 @@
  * Date: 8/8/2019
  * Description: This program will generate an key of a specific length to be used in the encryption and
  *	decription of plaintext strings.
+ *		keygen [-t threads] length > key
+ *		keygen [-t threads] -o key length
+ *	The key's characters come from ChaCha20 keystreams, each keyed with fresh bytes from the kernel's
+ *	random number generator (getrandom), so no two runs ever make the same key. Each random byte below
+ *	243 (the largest multiple of 27 that fits in a byte) picks one of the 27 characters, and any other
+ *	byte is thrown away, so every character is exactly as likely as the others.
+ *	The key is made a block at a time by several threads, each with its own keystream, and every block is
+ *	written out as soon as it is done, so keys of any length come out at full speed in a fixed amount of
+ *	memory. The blocks are all random, so it doesn't matter in which order they're written.
+ *	With -o the key is made straight in the file instead. Its full size is allocated up front, so a full
+ *	disk is found before any work is done, and the threads fill their own blocks of it through one shared
+ *	writable mapping, with no copying and no waiting on each other. The file is flushed to disk once, at
+ *	the end. It is made under a hidden name in the same directory and only renamed to the name it was
+ *	given once it's complete, so a daemon loading pads from that directory never sees half a key.
 */
 
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <time.h>
+#include <stdint.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/random.h>
+#include "otp_cipher.h"
+
+// how many characters a thread makes before writing them out
+#define BLOCK_SIZE 1048576
+
+// the most threads keygen will start
+#define MAX_THREADS 256
+
+// the largest multiple of the alphabet size that fits in a byte, random bytes at or above it are
+// thrown away so that every character is equally likely
+#define SAMPLE_LIMIT (256 / OTP_ALPHABET_SIZE * OTP_ALPHABET_SIZE)
+
+// how many ChaCha20 blocks are made side by side, one in each lane of a vector
+#define LANES 8
+#define KEYSTREAM_SIZE (64 * LANES)
+
+// a vector of one 32 bit word from each of the blocks being made, which the compiler turns into SIMD
+// instructions on whatever the CPU has (pairs of SSE2 instructions on any x86-64, or AVX2)
+typedef uint32_t laneWords __attribute__((vector_size(4 * LANES)));
+
+// one thread's ChaCha20 keystream
+struct keystream {
+	uint32_t state[16];
+	unsigned char block[KEYSTREAM_SIZE];
+};
+
+// the character every random byte picks, or 0 if the byte is thrown away
+static char sampleTable[256];
+
+// the key's length, where the next block to hand out to a thread starts, and the lock for handing them out
+static long long keyLength = 0;
+static long long nextOffset = 0;
+static pthread_mutex_t offsetLock = PTHREAD_MUTEX_INITIALIZER;
+
+// the key file's mapping with -o, or NULL if the key goes to stdout
+static char *keyMap = NULL;
+
+// only one thread writes to stdout at a time
+static pthread_mutex_t outputLock = PTHREAD_MUTEX_INITIALIZER;
+
+void *generateBlocks(void *argument);
+void seedKeystream(struct keystream *stream);
+void nextKeystreamBlocks(struct keystream *stream);
+void fillBlock(struct keystream *stream, char block[], size_t length);
+void writeAll(const char buffer[], size_t length);
+void createKeyFile(const char *fileName, int *fileFD, char **partialName);
+
+
 
 int main(int argc, char *argv[]){
-	srand(time(NULL));
 
-	int length = -1;
-	int randIndex = -5;
+	// prepare variables to be used in the program
+	// give them all bogus values so I know if they aren't being changed properly
+	long long length = -1;
+	long threadCount = -1;
+	int option = -1;
+	int i = 0;
+	int fileFD = -1;
+	int error = 0;
+	char *end = NULL;
+	const char *fileName = NULL;
+	char *partialName = NULL;
+	pthread_t threads[MAX_THREADS];
+
+	threadCount = sysconf(_SC_NPROCESSORS_ONLN);
+
+	// "-t threads" sets how many threads make the key, one per core by default, and "-o file"
+	// makes the key in a file instead of printing it
+	while((option = getopt(argc, argv, "t:o:")) != -1){
+		switch(option){
+			case 't':
+				threadCount = atol(optarg);
+				if(threadCount < 1 || threadCount > MAX_THREADS){
+					fprintf(stderr, "Error: thread count must be from 1 to %d\n", MAX_THREADS);
+					exit(1);
+				}
+				break;
+
+			case 'o':
+				fileName = optarg;
+				break;
+
+			default:
+				fprintf(stderr, "Usage: keygen [-t threads] [-o file] length\n");
+				exit(1);
+		}
+	}
 
 	// ensure the correct number of arguments are provided on the command line
-	if (argc < 2){
+	if (optind != argc - 1){
 		fprintf(stderr, "Error: invalid number of arguments\n");
 		exit(1);
 	}
 
-	// convert the char length into an integer
-	length = atoi(argv[1]);
+	// convert the char length into a number, which can be well past 2GB
+	length = strtoll(argv[optind], &end, 10);
+	if(end == argv[optind] || *end != '\0' || length < 0){
+		fprintf(stderr, "Error: invalid key length '%s'\n", argv[optind]);
+		exit(1);
+	}
 
+	if(threadCount < 1){
+		threadCount = 1;
+	}
+	if(threadCount > MAX_THREADS){
+		threadCount = MAX_THREADS;
+	}
 
-	// Dynamically create the buffer that will hold the randomly generated key string
-	// This ensures the char array pointed to will be the exact length given on the command line
-	char *buffer = malloc(sizeof(char) * length);
+	// there's no use starting a thread that would have no block to make
+	if(threadCount > length / BLOCK_SIZE + 1){
+		threadCount = length / BLOCK_SIZE + 1;
+	}
 
-	// Initialize the array of available chars so the function has a list to index from
-	char list[27] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ ";
+	for(i = 0; i < 256; i++){
+		sampleTable[i] = (i < SAMPLE_LIMIT) ? otpCharList[i % OTP_ALPHABET_SIZE] : 0;
+	}
 
-	int i = 0;
 
-	// Fill each element in the key string with a randomly generated char
-	// This is the string that will be printed to stdout for other programs to use
-	for(i = 0; i < length; i++){
-		randIndex = rand() % 27;
-		buffer[i] = list[randIndex];
+
+
+	// the file holds the key and its newline
+	if(fileName != NULL){
+		createKeyFile(fileName, &fileFD, &partialName);
+
+		// posix_fallocate() writes the blocks out itself where the file system can't set them aside,
+		// so the file is never left sparse and a full disk can't turn up halfway through the key
+		error = posix_fallocate(fileFD, 0, length + 1);
+		if(error != 0){
+			fprintf(stderr, "Error: could not make room for the key: %s\n", strerror(error));
+			unlink(partialName);
+			exit(1);
+		}
+
+		keyMap = mmap(NULL, length + 1, PROT_READ | PROT_WRITE, MAP_SHARED, fileFD, 0);
+		if(keyMap == MAP_FAILED){
+			perror("Error: could not map the key file");
+			unlink(partialName);
+			exit(1);
+		}
+	}
+
+
+
+
+	// every thread makes and writes blocks until the whole key has been handed out
+	keyLength = length;
+	for(i = 0; i < threadCount; i++){
+		if(pthread_create(&threads[i], NULL, generateBlocks, NULL) != 0){
+			fprintf(stderr, "Error: could not start a thread\n");
+			exit(1);
+		}
+	}
+
+	for(i = 0; i < threadCount; i++){
+		pthread_join(threads[i], NULL);
+	}
+
+	// the key ends with a newline like any other file the clients read
+	if(keyMap == NULL){
+		writeAll("\n", 1);
+		return 0;
 	}
 
-	// print to stdout
-	fprintf(stdout, "%s\n", buffer);
+	keyMap[length] = '\n';
+	munmap(keyMap, length + 1);
 
-	free(buffer);
+	// one flush for the whole key, then it can take its real name
+	if(fsync(fileFD) < 0 || close(fileFD) < 0 || rename(partialName, fileName) < 0){
+		perror("Error: could not write the key file");
+		unlink(partialName);
+		exit(1);
+	}
+
+	free(partialName);
 	return 0;
-}
\ No newline at end of file
+}
+
+
+
+
+/*
+ * Function Name: generateBlocks()
+ * Description: This function is run by every thread. It takes the next block of the key, fills it with
+ *		random characters from its own keystream and writes it out, until there is nothing left. With
+ *		a key file the block is filled in place in the file's mapping, which needs no lock since no
+ *		two threads are ever given the same block.
+ * Preconditions: sampleTable and keyLength must be set, and keyMap if the key goes to a file.
+ * Postconditions: The blocks this thread took have been written to stdout or the key file
+ * Returns: NULL
+*/
+void *generateBlocks(void *argument){
+	struct keystream stream;
+	char *block = NULL;
+	long long offset = 0;
+	long long length = 0;
+
+	(void)argument;
+
+	if(keyMap == NULL){
+		block = malloc(BLOCK_SIZE);
+		if(block == NULL){
+			fprintf(stderr, "Error: out of memory\n");
+			exit(1);
+		}
+	}
+
+	seedKeystream(&stream);
+
+	while(1){
+		pthread_mutex_lock(&offsetLock);
+		offset = nextOffset;
+		length = (keyLength - offset < BLOCK_SIZE) ? keyLength - offset : BLOCK_SIZE;
+		nextOffset += length;
+		pthread_mutex_unlock(&offsetLock);
+
+		if(length == 0){
+			break;
+		}
+
+		if(keyMap != NULL){
+			fillBlock(&stream, keyMap + offset, length);
+			continue;
+		}
+
+		fillBlock(&stream, block, length);
+
+		pthread_mutex_lock(&outputLock);
+		writeAll(block, length);
+		pthread_mutex_unlock(&outputLock);
+	}
+
+	// the keystream could make every later key, so don't leave it lying around
+	memset(&stream, 0, sizeof(stream));
+	free(block);
+	return NULL;
+}
+
+
+
+
+/*
+ * Function Name: seedKeystream()
+ * Description: This function sets up a ChaCha20 keystream with a 256 bit key and 64 bit nonce from
+ *		getrandom(), and its 64 bit block counter at 0. The counter never wraps around for any key
+ *		that could be stored.
+ * Preconditions: none
+ * Postconditions: The keystream is ready, or the program has exited with an error
+ * Returns: none
+*/
+void seedKeystream(struct keystream *stream){
+	unsigned char seed[40];
+	int i = 0;
+
+	if(getrandom(seed, sizeof(seed), 0) != (ssize_t)sizeof(seed)){
+		fprintf(stderr, "Error: could not get random bytes from the kernel\n");
+		exit(1);
+	}
+
+	// "expand 32-byte k"
+	stream->state[0] = 0x61707865;
+	stream->state[1] = 0x3320646e;
+	stream->state[2] = 0x79622d32;
+	stream->state[3] = 0x6b206574;
+
+	for(i = 0; i < 8; i++){
+		stream->state[4 + i] = seed[4 * i] | (seed[4 * i + 1] << 8) | (seed[4 * i + 2] << 16) | ((uint32_t)seed[4 * i + 3] << 24);
+	}
+
+	stream->state[12] = 0;
+	stream->state[13] = 0;
+	stream->state[14] = seed[32] | (seed[33] << 8) | (seed[34] << 16) | ((uint32_t)seed[35] << 24);
+	stream->state[15] = seed[36] | (seed[37] << 8) | (seed[38] << 16) | ((uint32_t)seed[39] << 24);
+
+	memset(seed, 0, sizeof(seed));
+}
+
+
+
+
+#define ROTATE(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+#define QUARTER_ROUND(a, b, c, d) \
+	a += b; d ^= a; d = ROTATE(d, 16); \
+	c += d; b ^= c; b = ROTATE(b, 12); \
+	a += b; d ^= a; d = ROTATE(d, 8); \
+	c += d; b ^= c; b = ROTATE(b, 7);
+
+/*
+ * Function Name: nextKeystreamBlocks()
+ * Description: This function runs the ChaCha20 block function for the next LANES counter values at
+ *		once, puts the results in the keystream's block, and steps the counter past them. The words of
+ *		the blocks end up interleaved, which doesn't matter since every byte is used the same way.
+ *		An AVX2 copy of it is also built, and used if the CPU has AVX2.
+ * Preconditions: The keystream must have been seeded.
+ * Postconditions: The block holds the next KEYSTREAM_SIZE bytes of the keystream
+ * Returns: none
+*/
+__attribute__((target_clones("avx2", "default")))
+void nextKeystreamBlocks(struct keystream *stream){
+	laneWords x[16];
+	laneWords start[16];
+	uint64_t counter = stream->state[12] | ((uint64_t)stream->state[13] << 32);
+	int i = 0;
+
+	for(i = 0; i < 16; i++){
+		start[i] = (laneWords){ 0 } + stream->state[i];
+	}
+
+	// each lane has its own block counter
+	for(i = 0; i < LANES; i++){
+		start[12][i] = (uint32_t)(counter + i);
+		start[13][i] = (uint32_t)((counter + i) >> 32);
+	}
+
+	memcpy(x, start, sizeof(x));
+
+	for(i = 0; i < 10; i++){
+		QUARTER_ROUND(x[0], x[4], x[8], x[12]);
+		QUARTER_ROUND(x[1], x[5], x[9], x[13]);
+		QUARTER_ROUND(x[2], x[6], x[10], x[14]);
+		QUARTER_ROUND(x[3], x[7], x[11], x[15]);
+		QUARTER_ROUND(x[0], x[5], x[10], x[15]);
+		QUARTER_ROUND(x[1], x[6], x[11], x[12]);
+		QUARTER_ROUND(x[2], x[7], x[8], x[13]);
+		QUARTER_ROUND(x[3], x[4], x[9], x[14]);
+	}
+
+	for(i = 0; i < 16; i++){
+		x[i] += start[i];
+	}
+	memcpy(stream->block, x, sizeof(x));
+
+	counter += LANES;
+	stream->state[12] = (uint32_t)counter;
+	stream->state[13] = (uint32_t)(counter >> 32);
+}
+
+
+
+
+/*
+ * Function Name: fillBlock()
+ * Description: This function fills a block of the key with random characters. Every keystream byte is
+ *		looked up in sampleTable and kept only if it picks a character, without a branch, so the
+ *		bytes that are thrown away cost no more than the ones that are kept.
+ * Preconditions: The keystream must have been seeded.
+ * Postconditions: The first length chars of the block are random characters from the alphabet
+ * Returns: none
+*/
+void fillBlock(struct keystream *stream, char block[], size_t length){
+	size_t filled = 0;
+	int i = 0;
+	char c = 0;
+
+	// while a whole keystream block fits, nothing needs checking but the table
+	while(filled + KEYSTREAM_SIZE <= length){
+		nextKeystreamBlocks(stream);
+		for(i = 0; i < KEYSTREAM_SIZE; i++){
+			c = sampleTable[stream->block[i]];
+			block[filled] = c;
+			filled += (c != 0);
+		}
+	}
+
+	// the last few characters stop as soon as the block is full
+	while(filled < length){
+		nextKeystreamBlocks(stream);
+		for(i = 0; i < KEYSTREAM_SIZE && filled < length; i++){
+			c = sampleTable[stream->block[i]];
+			block[filled] = c;
+			filled += (c != 0);
+		}
+	}
+}
+
+
+
+
+/*
+ * Function Name: writeAll()
+ * Description: This function writes a buffer to stdout, however many calls it takes.
+ * Preconditions: none
+ * Postconditions: The buffer has been written, or the program has exited with an error
+ * Returns: none
+*/
+void writeAll(const char buffer[], size_t length){
+	ssize_t charsWritten = -1;
+
+	while(length > 0){
+		charsWritten = write(STDOUT_FILENO, buffer, length);
+		if(charsWritten < 0 && errno == EINTR){
+			continue;
+		}
+		if(charsWritten <= 0){
+			fprintf(stderr, "Error: could not write the key\n");
+			exit(1);
+		}
+		buffer += charsWritten;
+		length -= charsWritten;
+	}
+}
+
+
+
+
+/*
+ * Function Name: createKeyFile()
+ * Description: This function creates the file the key is made in, under a hidden name next to where it
+ *		will end up, e.g. ".key.partial" for "dir/key". Any file of that name left by a run that
+ *		didn't finish is replaced.
+ * Preconditions: none
+ * Postconditions: The file is open for reading and writing, or the program has exited with an error
+ * Returns: none, the file and its hidden name are put in fileFD and partialName
+*/
+void createKeyFile(const char *fileName, int *fileFD, char **partialName){
+	const char *baseName = (strrchr(fileName, '/') != NULL) ? strrchr(fileName, '/') + 1 : fileName;
+	size_t nameLength = strlen(fileName) + sizeof(".partial") + 1;
+
+	*partialName = malloc(nameLength);
+	if(*partialName == NULL){
+		fprintf(stderr, "Error: out of memory\n");
+		exit(1);
+	}
+	snprintf(*partialName, nameLength, "%.*s.%s.partial", (int)(baseName - fileName), fileName, baseName);
+
+	*fileFD = open(*partialName, O_RDWR | O_CREAT | O_TRUNC, 0600);
+	if(*fileFD < 0){
+		fprintf(stderr, "Error: could not create '%s'\n", *partialName);
+		exit(1);
+	}
+}
@@ -0,0 +1,891 @@
+/*
+ * Author: John Olgin
+ * Program Name: otp_bench.c
+ * Date: 10/18/26
+ * Description: This program is a load generator for the otp_enc_d and otp_dec_d daemons. It keeps a number
+ *	of connections busy at once, each sending one message at a time with a size picked from a given
+ *	distribution, for either a fixed number of messages or a fixed number of seconds. Every encrypted
+ *	message is checked against libotp, and when a decryption daemon is given too, it is decrypted there
+ *	and checked against the original. When the run is over the throughput and latency are printed as JSON
+ *	so runs against different daemon versions can be compared.
+ *		otp_bench [-c connections] [-n messages | -d seconds] [-s sizes] [-r] [-p pids] [-k pad] enc_port [dec_port]
+ *	Sizes are a comma separated list of lengths or min-max ranges, e.g. "64,1024-65536". Each message
+ *	picks one of the entries at random, and a random length inside it for a range. With -r every request
+ *	gets a new connection instead of reusing one. With -p, a comma separated list of the daemons' process
+ *	ids, the CPU time the daemons spent in user and kernel mode is reported per request as well, which is
+ *	where the cost of their system calls shows up when comparing serving modes. With -k, every key is cut
+ *	from the given pad at a random offset and sent as a reference to it, so the daemons must have been
+ *	started with the pad's directory and the pad's file name is its id.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <netdb.h>
+#include "otp_protocol.h"
+#include "otp_cipher.h"
+
+#define MAX_SIZES 32
+
+// a request that hasn't been answered after this many seconds is given up on
+#define REQUEST_TIMEOUT 10
+#define MAX_PIDS 8
+
+// the operations a connection's requests move through, a message is done after the
+// encryption if there's no decryption daemon to check it with
+enum benchPhase { IDLE, ENCRYPTING, DECRYPTING };
+
+// one entry of the size distribution
+struct sizeRange {
+	size_t minimum;
+	size_t maximum;
+};
+
+// the latencies of every request of one operation, in nanoseconds
+struct latencyList {
+	uint64_t *values;
+	size_t count;
+	size_t capacity;
+	uint64_t bytes;
+};
+
+// everything the benchmark remembers about one of its connections
+struct benchConnection {
+	int socketFD[2];
+	enum benchPhase phase;
+	uint32_t requestId;
+	size_t length;
+	const char *text;
+	const char *key;
+	char *expected;
+	char *request;
+	size_t requestLength;
+	size_t requestSent;
+	char *response;
+	size_t responseLength;
+	size_t responseRead;
+	struct timespec started;
+	uint64_t keyOffset;
+};
+
+// the settings for the run, and its results so far
+static const char *daemonAddress[2] = { NULL, NULL };
+static struct sizeRange sizes[MAX_SIZES];
+static int sizeCount = 0;
+static size_t maxSize = 0;
+static int reconnect = 0;
+static uint64_t randomState = 88172645463325252ULL;
+static struct latencyList latencies[2];
+static long errors = 0;
+static long timeouts = 0;
+static long mismatches = 0;
+static pid_t daemonPids[MAX_PIDS];
+static int pidCount = 0;
+static const char *padId = NULL;
+static const char *pad = NULL;
+static size_t padLength = 0;
+
+int parseSizes(const char *spec);
+size_t pickSize(void);
+uint64_t nextRandom(void);
+int connectDaemon(const char *address);
+int startMessage(struct benchConnection *conn, const char *textPool, const char *keyPool);
+void buildRequest(struct benchConnection *conn, int operation, const char *payload);
+int serviceBenchConnection(struct benchConnection *conn, short revents);
+int finishRequest(struct benchConnection *conn);
+void dropConnection(struct benchConnection *conn);
+void recordLatency(struct latencyList *list, uint64_t nanoseconds, size_t length);
+uint64_t elapsedNanoseconds(const struct timespec *start, const struct timespec *end);
+int compareLatency(const void *a, const void *b);
+void printLatency(const char *name, struct latencyList *list, int last);
+int parsePids(const char *spec);
+void readDaemonTimes(double *userSeconds, double *systemSeconds);
+void mapPad(const char *fileName);
+
+
+int main(int argc, char *argv[]){
+
+	// prepare variables to be used in the program
+	// give them all bogus values so I know if they aren't being changed properly
+	int connectionCount = 8;
+	long messageLimit = -1;
+	double secondsLimit = -1;
+	long messagesStarted = 0;
+	long messagesDone = 0;
+	int active = 0;
+	int option = -1;
+	int i = 0;
+	size_t position = 0;
+	char *textPool = NULL;
+	char *keyPool = NULL;
+	struct benchConnection *conns = NULL;
+	struct pollfd *pollInfo = NULL;
+	struct timespec startTime;
+	struct timespec now;
+	double seconds = 0;
+	uint64_t totalRequests = 0;
+	uint64_t totalBytes = 0;
+	double startUser = 0;
+	double startSystem = 0;
+	double endUser = 0;
+	double endSystem = 0;
+
+	// read the options
+	while((option = getopt(argc, argv, "c:n:d:s:rp:k:")) != -1){
+		switch(option){
+			case 'c':
+				connectionCount = atoi(optarg);
+				break;
+
+			case 'n':
+				messageLimit = atol(optarg);
+				break;
+
+			case 'd':
+				secondsLimit = atof(optarg);
+				break;
+
+			case 's':
+				if(parseSizes(optarg) < 0){
+					fprintf(stderr, "Error: bad size list '%s'\n", optarg);
+					exit(1);
+				}
+				break;
+
+			case 'r':
+				reconnect = 1;
+				break;
+
+			case 'p':
+				if(parsePids(optarg) < 0){
+					fprintf(stderr, "Error: bad process id list '%s'\n", optarg);
+					exit(1);
+				}
+				break;
+
+			case 'k':
+				mapPad(optarg);
+				break;
+
+			default:
+				fprintf(stderr, "Usage: otp_bench [-c connections] [-n messages | -d seconds] [-s sizes] [-r] [-p pids] [-k pad] enc_port [dec_port]\n");
+				exit(1);
+		}
+	}
+
+	if(argc - optind < 1 || argc - optind > 2 || connectionCount < 1){
+		fprintf(stderr, "Usage: otp_bench [-c connections] [-n messages | -d seconds] [-s sizes] [-r] [-p pids] [-k pad] enc_port [dec_port]\n");
+		exit(1);
+	}
+
+	daemonAddress[0] = argv[optind];
+	if(argc - optind == 2){
+		daemonAddress[1] = argv[optind + 1];
+	}
+
+	// run for 10 seconds unless told otherwise
+	if(messageLimit < 0 && secondsLimit < 0){
+		secondsLimit = 10;
+	}
+
+	if(sizeCount == 0){
+		parseSizes("1024");
+	}
+
+	if(pad != NULL && padLength < maxSize){
+		fprintf(stderr, "Error: the pad is shorter than the longest message\n");
+		exit(1);
+	}
+
+
+
+
+	// every message is a random piece of these pools, so nothing has to be generated
+	// while the clock is running
+	otpInit();
+	textPool = malloc(2 * maxSize + 1);
+	keyPool = malloc(2 * maxSize + 1);
+	conns = calloc(connectionCount, sizeof(struct benchConnection));
+	pollInfo = calloc(connectionCount, sizeof(struct pollfd));
+	if(textPool == NULL || keyPool == NULL || conns == NULL || pollInfo == NULL){
+		fprintf(stderr, "Error: out of memory\n");
+		exit(1);
+	}
+
+	for(position = 0; position < 2 * maxSize + 1; position++){
+		textPool[position] = otpCharList[nextRandom() % OTP_ALPHABET_SIZE];
+		keyPool[position] = otpCharList[nextRandom() % OTP_ALPHABET_SIZE];
+	}
+
+	for(i = 0; i < connectionCount; i++){
+		conns[i].socketFD[0] = -1;
+		conns[i].socketFD[1] = -1;
+		conns[i].expected = malloc(maxSize + 1);
+		conns[i].request = malloc(OTP_REQUEST_HEADER_SIZE + OTP_KEY_REFERENCE_MAX + 2 * maxSize);
+		conns[i].response = malloc(OTP_RESPONSE_HEADER_SIZE + maxSize);
+		if(conns[i].expected == NULL || conns[i].request == NULL || conns[i].response == NULL){
+			fprintf(stderr, "Error: out of memory\n");
+			exit(1);
+		}
+	}
+
+	// a daemon that hangs up on us shouldn't kill the benchmark
+	signal(SIGPIPE, SIG_IGN);
+
+
+
+
+	readDaemonTimes(&startUser, &startSystem);
+	clock_gettime(CLOCK_MONOTONIC, &startTime);
+	now = startTime;
+
+	while(1){
+		// keep every idle connection busy until the run is over
+		for(i = 0; i < connectionCount; i++){
+			if(conns[i].phase != IDLE){
+				continue;
+			}
+
+			seconds = elapsedNanoseconds(&startTime, &now) / 1e9;
+			if((messageLimit >= 0 && messagesStarted >= messageLimit) || (secondsLimit >= 0 && seconds >= secondsLimit)){
+				continue;
+			}
+
+			if(startMessage(&conns[i], textPool, keyPool) < 0){
+				fprintf(stderr, "Error: could not contact the daemon on %s\n", daemonAddress[0]);
+				exit(1);
+			}
+			messagesStarted++;
+		}
+
+		// wait on whichever socket each busy connection is using
+		active = 0;
+		for(i = 0; i < connectionCount; i++){
+			pollInfo[i].fd = -1;
+			pollInfo[i].events = 0;
+			pollInfo[i].revents = 0;
+
+			if(conns[i].phase != IDLE){
+				pollInfo[i].fd = conns[i].socketFD[conns[i].phase - ENCRYPTING];
+				pollInfo[i].events = (conns[i].requestSent < conns[i].requestLength) ? POLLIN | POLLOUT : POLLIN;
+				active++;
+			}
+		}
+
+		if(active == 0){
+			break;
+		}
+
+		if(poll(pollInfo, connectionCount, 1000) < 0 && errno != EINTR){
+			perror("Error: poll failed");
+			exit(1);
+		}
+
+		for(i = 0; i < connectionCount; i++){
+			if(pollInfo[i].revents == 0){
+				continue;
+			}
+
+			if(serviceBenchConnection(&conns[i], pollInfo[i].revents) < 0){
+				errors++;
+				dropConnection(&conns[i]);
+			}
+			else if(conns[i].phase == IDLE){
+				messagesDone++;
+			}
+		}
+
+		clock_gettime(CLOCK_MONOTONIC, &now);
+
+		// a daemon that never answers (e.g. every pre-forked worker is busy with another
+		// connection) mustn't hang the run
+		for(i = 0; i < connectionCount; i++){
+			if(conns[i].phase != IDLE && elapsedNanoseconds(&conns[i].started, &now) > REQUEST_TIMEOUT * 1000000000ULL){
+				timeouts++;
+				dropConnection(&conns[i]);
+			}
+		}
+	}
+
+	seconds = elapsedNanoseconds(&startTime, &now) / 1e9;
+	readDaemonTimes(&endUser, &endSystem);
+
+
+
+
+	// print the report
+	totalRequests = latencies[0].count + latencies[1].count;
+	totalBytes = latencies[0].bytes + latencies[1].bytes;
+
+	printf("{\n");
+	printf("  \"connections\": %d,\n", connectionCount);
+	printf("  \"reconnect\": %s,\n", reconnect ? "true" : "false");
+	printf("  \"verify_decrypt\": %s,\n", (daemonAddress[1] != NULL) ? "true" : "false");
+	printf("  \"seconds\": %.3f,\n", seconds);
+	printf("  \"messages\": %ld,\n", messagesDone);
+	printf("  \"requests\": %llu,\n", (unsigned long long)totalRequests);
+	printf("  \"errors\": %ld,\n", errors);
+	printf("  \"timeouts\": %ld,\n", timeouts);
+	printf("  \"mismatches\": %ld,\n", mismatches);
+	printf("  \"requests_per_sec\": %.1f,\n", (seconds > 0) ? totalRequests / seconds : 0);
+	printf("  \"mb_per_sec\": %.3f,\n", (seconds > 0) ? totalBytes / seconds / 1e6 : 0);
+	if(pidCount > 0 && totalRequests > 0){
+		printf("  \"daemon_cpu_us_per_request\": {\"user\": %.2f, \"system\": %.2f},\n",
+			(endUser - startUser) * 1e6 / totalRequests, (endSystem - startSystem) * 1e6 / totalRequests);
+	}
+	printf("  \"latency_us\": {\n");
+	printLatency("encrypt", &latencies[0], daemonAddress[1] == NULL);
+	if(daemonAddress[1] != NULL){
+		printLatency("decrypt", &latencies[1], 1);
+	}
+	printf("  }\n");
+	printf("}\n");
+
+	return (errors > 0 || timeouts > 0 || mismatches > 0) ? 1 : 0;
+}
+
+
+/*
+ * Function Name: parsePids()
+ * Description: This function reads the list of daemon process ids whose CPU time is reported.
+ * Preconditions: The list must be comma separated process ids.
+ * Postconditions: The ids have been added to daemonPids
+ * Returns: 0 on success, -1 if the list can't be read
+*/
+int parsePids(const char *spec){
+	const char *position = spec;
+	char *end = NULL;
+	long pid = -1;
+
+	while(*position != '\0'){
+		pid = strtol(position, &end, 10);
+		if(end == position || pid <= 0 || pidCount == MAX_PIDS){
+			return -1;
+		}
+
+		daemonPids[pidCount++] = pid;
+		position = (*end == ',') ? end + 1 : end;
+		if(*end != ',' && *end != '\0'){
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+
+/*
+ * Function Name: readDaemonTimes()
+ * Description: This function adds up the user and system CPU time of every daemon given with -p, from
+ *		/proc/<pid>/stat. The time of children the daemon has already reaped is included, so the
+ *		forking mode's per connection processes are counted too.
+ * Preconditions: none
+ * Postconditions: The totals are stored in the two arguments
+ * Returns: none
+*/
+void readDaemonTimes(double *userSeconds, double *systemSeconds){
+	char path[64];
+	char line[1024];
+	char *position = NULL;
+	unsigned long long userTicks = 0;
+	unsigned long long systemTicks = 0;
+	unsigned long long childUserTicks = 0;
+	unsigned long long childSystemTicks = 0;
+	long ticksPerSecond = sysconf(_SC_CLK_TCK);
+	FILE *statFile = NULL;
+	int i = 0;
+
+	*userSeconds = 0;
+	*systemSeconds = 0;
+
+	for(i = 0; i < pidCount; i++){
+		snprintf(path, sizeof(path), "/proc/%d/stat", (int)daemonPids[i]);
+		statFile = fopen(path, "r");
+		if(statFile == NULL){
+			fprintf(stderr, "Error: could not read '%s'\n", path);
+			exit(1);
+		}
+
+		// the name can hold spaces, so the fields are counted from the ')' that ends it
+		position = (fgets(line, sizeof(line), statFile) != NULL) ? strrchr(line, ')') : NULL;
+		fclose(statFile);
+		if(position == NULL || sscanf(position + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %llu %llu %llu %llu",
+		   &userTicks, &systemTicks, &childUserTicks, &childSystemTicks) != 4){
+			fprintf(stderr, "Error: could not read '%s'\n", path);
+			exit(1);
+		}
+
+		*userSeconds += (double)(userTicks + childUserTicks) / ticksPerSecond;
+		*systemSeconds += (double)(systemTicks + childSystemTicks) / ticksPerSecond;
+	}
+}
+
+
+/*
+ * Function Name: mapPad()
+ * Description: This function maps the pad given with -k. The pad ends at its first newline like any
+ *		key, and its id is its file name without the directory.
+ * Preconditions: none
+ * Postconditions: pad, padLength and padId are set, or the program has exited with an error
+ * Returns: none
+*/
+void mapPad(const char *fileName){
+	struct stat fileInfo;
+	const char *newline = NULL;
+	void *map = NULL;
+	int fileFD = open(fileName, O_RDONLY);
+
+	if(fileFD < 0 || fstat(fileFD, &fileInfo) < 0 || fileInfo.st_size == 0){
+		fprintf(stderr, "Error: could not open '%s'\n", fileName);
+		exit(1);
+	}
+
+	map = mmap(NULL, fileInfo.st_size, PROT_READ, MAP_PRIVATE, fileFD, 0);
+	close(fileFD);
+	if(map == MAP_FAILED){
+		fprintf(stderr, "Error: could not map '%s'\n", fileName);
+		exit(1);
+	}
+
+	newline = memchr(map, '\n', fileInfo.st_size);
+	pad = map;
+	padLength = (newline == NULL) ? (size_t)fileInfo.st_size : (size_t)(newline - pad);
+	padId = (strrchr(fileName, '/') != NULL) ? strrchr(fileName, '/') + 1 : fileName;
+
+	if(strlen(padId) > OTP_KEY_ID_MAX){
+		fprintf(stderr, "Error: the pad's name is too long to be an id\n");
+		exit(1);
+	}
+}
+
+
+/*
+ * Function Name: parseSizes()
+ * Description: This function adds the entries of a size list to the distribution messages are picked from.
+ * Preconditions: The list must be comma separated lengths or min-max ranges.
+ * Postconditions: The entries have been added and maxSize covers all of them
+ * Returns: 0 on success, -1 if the list can't be read
+*/
+int parseSizes(const char *spec){
+	const char *position = spec;
+	char *end = NULL;
+
+	while(*position != '\0'){
+		if(sizeCount == MAX_SIZES){
+			return -1;
+		}
+
+		sizes[sizeCount].minimum = strtoul(position, &end, 10);
+		if(end == position){
+			return -1;
+		}
+		sizes[sizeCount].maximum = sizes[sizeCount].minimum;
+
+		if(*end == '-'){
+			position = end + 1;
+			sizes[sizeCount].maximum = strtoul(position, &end, 10);
+			if(end == position || sizes[sizeCount].maximum < sizes[sizeCount].minimum){
+				return -1;
+			}
+		}
+
+		if(sizes[sizeCount].maximum > maxSize){
+			maxSize = sizes[sizeCount].maximum;
+		}
+		sizeCount++;
+
+		if(*end == ','){
+			end++;
+		}
+		else if(*end != '\0'){
+			return -1;
+		}
+		position = end;
+	}
+
+	return (sizeCount > 0) ? 0 : -1;
+}
+
+
+/*
+ * Function Name: pickSize()
+ * Description: This function picks the length of the next message from the size distribution.
+ * Preconditions: At least one size must have been parsed.
+ * Postconditions: none
+ * Returns: the length
+*/
+size_t pickSize(void){
+	const struct sizeRange *range = &sizes[nextRandom() % sizeCount];
+
+	return range->minimum + nextRandom() % (range->maximum - range->minimum + 1);
+}
+
+
+/*
+ * Function Name: nextRandom()
+ * Description: This function is a small xorshift generator, so picking sizes and offsets costs
+ *		next to nothing and every run picks the same sequence.
+ * Preconditions: none
+ * Postconditions: The generator has moved on
+ * Returns: the next random number
+*/
+uint64_t nextRandom(void){
+	randomState ^= randomState << 13;
+	randomState ^= randomState >> 7;
+	randomState ^= randomState << 17;
+	return randomState;
+}
+
+
+/*
+ * Function Name: connectDaemon()
+ * Description: This function connects to a daemon on a TCP port of this host, or on a Unix domain
+ *		socket if the address contains a '/', and makes the socket non-blocking.
+ * Preconditions: none
+ * Postconditions: none
+ * Returns: the connected socket, or -1 on error
+*/
+int connectDaemon(const char *address){
+	struct sockaddr_in serverAddress;
+	struct sockaddr_un socketAddress;
+	int socketFD = -1;
+	int result = -1;
+	int noDelay = 1;
+
+	if(strchr(address, '/') != NULL){
+		memset(&socketAddress, 0, sizeof(socketAddress));
+		socketAddress.sun_family = AF_UNIX;
+		strncpy(socketAddress.sun_path, address, sizeof(socketAddress.sun_path) - 1);
+
+		socketFD = socket(AF_UNIX, SOCK_STREAM, 0);
+		if(socketFD < 0){
+			return -1;
+		}
+		result = connect(socketFD, (struct sockaddr *)&socketAddress, sizeof(socketAddress));
+	}
+	else{
+		memset(&serverAddress, 0, sizeof(serverAddress));
+		serverAddress.sin_family = AF_INET;
+		serverAddress.sin_port = htons(atoi(address));
+		serverAddress.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+		socketFD = socket(AF_INET, SOCK_STREAM, 0);
+		if(socketFD < 0){
+			return -1;
+		}
+		result = connect(socketFD, (struct sockaddr *)&serverAddress, sizeof(serverAddress));
+
+		// every request goes out in one send, so there's nothing for Nagle to batch and
+		// holding back its last segment would only add a delayed ACK to the latency
+		setsockopt(socketFD, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+	}
+
+	if(result < 0){
+		close(socketFD);
+		return -1;
+	}
+
+	fcntl(socketFD, F_SETFL, fcntl(socketFD, F_GETFL, 0) | O_NONBLOCK);
+	return socketFD;
+}
+
+
+/*
+ * Function Name: startMessage()
+ * Description: This function picks a new message and its key from the pools, works out what its
+ *		encryption should be, and starts the encryption request for it.
+ * Preconditions: The connection must be idle.
+ * Postconditions: The connection is sending the encryption request
+ * Returns: 0 on success, -1 if a daemon couldn't be contacted
+*/
+int startMessage(struct benchConnection *conn, const char *textPool, const char *keyPool){
+	int i = 0;
+
+	// open whichever connections aren't open
+	for(i = 0; i < 2; i++){
+		if(daemonAddress[i] != NULL && conn->socketFD[i] < 0){
+			conn->socketFD[i] = connectDaemon(daemonAddress[i]);
+			if(conn->socketFD[i] < 0){
+				return -1;
+			}
+		}
+	}
+
+	conn->length = pickSize();
+	conn->text = textPool + nextRandom() % (maxSize + 1);
+	conn->key = keyPool + nextRandom() % (maxSize + 1);
+
+	// with a pad, the key is the part of it a random offset picks
+	if(pad != NULL){
+		conn->keyOffset = nextRandom() % (padLength - conn->length + 1);
+		conn->key = pad + conn->keyOffset;
+	}
+	otpEncrypt(conn->key, conn->text, conn->expected, conn->length);
+
+	buildRequest(conn, OTP_OP_ENCRYPT, conn->text);
+	conn->phase = ENCRYPTING;
+
+	return 0;
+}
+
+
+/*
+ * Function Name: buildRequest()
+ * Description: This function lays out a whole request, the header followed by the payload and key
+ *		interleaved in chunks, and starts its clock.
+ * Preconditions: The connection must hold the message length and key.
+ * Postconditions: The request is ready to be sent
+ * Returns: none
+*/
+void buildRequest(struct benchConnection *conn, int operation, const char *payload){
+	struct otpRequest request;
+	size_t position = 0;
+	size_t chunkLength = 0;
+	char *body = conn->request + OTP_REQUEST_HEADER_SIZE;
+
+	request.magic = OTP_MAGIC;
+	request.version = OTP_VERSION;
+	request.operation = operation;
+	request.flags = 0;
+	request.requestId = ++conn->requestId;
+	request.payloadLength = conn->length;
+	request.keyLength = conn->length;
+
+	// with a pad, a reference to the key goes in front and no key chunks are sent
+	if(pad != NULL){
+		request.flags = OTP_FLAG_KEY_ID;
+		request.keyLength = packKeyReference(padId, strlen(padId), conn->keyOffset, (unsigned char *)body);
+		body += request.keyLength;
+	}
+	packRequest(&request, (unsigned char *)conn->request);
+
+	for(position = 0; position < conn->length; position += chunkLength){
+		chunkLength = (conn->length - position < CHUNK_SIZE) ? conn->length - position : CHUNK_SIZE;
+		memcpy(body, payload + position, chunkLength);
+		body += chunkLength;
+
+		if(pad == NULL){
+			memcpy(body, conn->key + position, chunkLength);
+			body += chunkLength;
+		}
+	}
+
+	conn->requestLength = body - conn->request;
+	conn->requestSent = 0;
+	conn->responseLength = OTP_RESPONSE_HEADER_SIZE + conn->length;
+	conn->responseRead = 0;
+	clock_gettime(CLOCK_MONOTONIC, &conn->started);
+}
+
+
+/*
+ * Function Name: serviceBenchConnection()
+ * Description: This function sends and receives as much of the current request and response as
+ *		the socket allows, and finishes the request once the whole response is in.
+ * Preconditions: The connection must be encrypting or decrypting.
+ * Postconditions: The counts have moved forward
+ * Returns: 0 if the connection is fine, -1 if it failed
+*/
+int serviceBenchConnection(struct benchConnection *conn, short revents){
+	int socketFD = conn->socketFD[conn->phase - ENCRYPTING];
+	ssize_t count = -1;
+
+	if((revents & POLLOUT) && conn->requestSent < conn->requestLength){
+		count = send(socketFD, conn->request + conn->requestSent, conn->requestLength - conn->requestSent, MSG_NOSIGNAL);
+		if(count < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR){
+			return -1;
+		}
+		if(count > 0){
+			conn->requestSent += count;
+		}
+	}
+
+	if(revents & (POLLIN | POLLHUP | POLLERR)){
+		count = recv(socketFD, conn->response + conn->responseRead, conn->responseLength - conn->responseRead, 0);
+		if(count == 0 || (count < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)){
+			return -1;
+		}
+		if(count > 0){
+			conn->responseRead += count;
+		}
+
+		// a rejected request is only a header
+		if(conn->responseRead >= OTP_RESPONSE_HEADER_SIZE && conn->response[5] != OTP_STATUS_OK){
+			return -1;
+		}
+
+		if(conn->responseRead == conn->responseLength){
+			return finishRequest(conn);
+		}
+	}
+
+	return 0;
+}
+
+
+/*
+ * Function Name: finishRequest()
+ * Description: This function records a finished request's latency and checks its result. An
+ *		encryption is followed by its decryption when there's a decryption daemon.
+ * Preconditions: The whole response must have been received.
+ * Postconditions: The connection is decrypting, or idle once the message is done
+ * Returns: 0 on success, -1 if the response header is wrong or a connection couldn't be reopened
+*/
+int finishRequest(struct benchConnection *conn){
+	struct otpResponse response;
+	struct timespec finished;
+	int operation = conn->phase - ENCRYPTING;
+	const char *result = conn->response + OTP_RESPONSE_HEADER_SIZE;
+
+	clock_gettime(CLOCK_MONOTONIC, &finished);
+	recordLatency(&latencies[operation], elapsedNanoseconds(&conn->started, &finished), conn->length);
+
+	unpackResponse((unsigned char *)conn->response, &response);
+	if(response.magic != OTP_MAGIC || response.version != OTP_VERSION || response.requestId != conn->requestId ||
+	   response.length != conn->length){
+		return -1;
+	}
+
+	// the encryption must match libotp's, and the decryption must give back the original
+	if(memcmp(result, (operation == 0) ? conn->expected : conn->text, conn->length) != 0){
+		mismatches++;
+	}
+
+	// with -r every request gets its own connection
+	if(reconnect){
+		close(conn->socketFD[operation]);
+		conn->socketFD[operation] = -1;
+	}
+
+	if(operation == 0 && daemonAddress[1] != NULL){
+		memcpy(conn->expected, result, conn->length);
+		if(conn->socketFD[1] < 0){
+			conn->socketFD[1] = connectDaemon(daemonAddress[1]);
+			if(conn->socketFD[1] < 0){
+				return -1;
+			}
+		}
+		buildRequest(conn, OTP_OP_DECRYPT, conn->expected);
+		conn->phase = DECRYPTING;
+	}
+	else{
+		conn->phase = IDLE;
+	}
+
+	return 0;
+}
+
+
+/*
+ * Function Name: dropConnection()
+ * Description: This function gives up on a connection's current message after an error or a
+ *		timeout. Its sockets are closed so the next message starts on fresh ones.
+ * Preconditions: none
+ * Postconditions: The connection is idle and has no sockets open
+ * Returns: none
+*/
+void dropConnection(struct benchConnection *conn){
+	close(conn->socketFD[0]);
+	close(conn->socketFD[1]);
+	conn->socketFD[0] = -1;
+	conn->socketFD[1] = -1;
+	conn->phase = IDLE;
+}
+
+
+/*
+ * Function Name: recordLatency()
+ * Description: This function adds one request's latency and length to a list.
+ * Preconditions: none
+ * Postconditions: The list holds the latency, and has grown if it had to
+ * Returns: none
+*/
+void recordLatency(struct latencyList *list, uint64_t nanoseconds, size_t length){
+	if(list->count == list->capacity){
+		size_t capacity = (list->capacity == 0) ? 4096 : 2 * list->capacity;
+		uint64_t *values = realloc(list->values, capacity * sizeof(uint64_t));
+
+		if(values == NULL){
+			fprintf(stderr, "Error: out of memory\n");
+			exit(1);
+		}
+		list->values = values;
+		list->capacity = capacity;
+	}
+
+	list->values[list->count++] = nanoseconds;
+	list->bytes += length;
+}
+
+
+/*
+ * Function Name: elapsedNanoseconds()
+ * Description: This function works out the time between two clock readings.
+ * Preconditions: The end must not be before the start.
+ * Postconditions: none
+ * Returns: the time between them in nanoseconds
+*/
+uint64_t elapsedNanoseconds(const struct timespec *start, const struct timespec *end){
+	return (uint64_t)(end->tv_sec - start->tv_sec) * 1000000000ULL + end->tv_nsec - start->tv_nsec;
+}
+
+
+/*
+ * Function Name: compareLatency()
+ * Description: This function orders two latencies for qsort().
+ * Preconditions: none
+ * Postconditions: none
+ * Returns: negative, zero or positive like strcmp()
+*/
+int compareLatency(const void *a, const void *b){
+	uint64_t first = *(const uint64_t *)a;
+	uint64_t second = *(const uint64_t *)b;
+
+	return (first > second) - (first < second);
+}
+
+
+/*
+ * Function Name: printLatency()
+ * Description: This function prints the percentiles of a latency list as a JSON object.
+ * Preconditions: none
+ * Postconditions: The list is sorted
+ * Returns: none
+*/
+void printLatency(const char *name, struct latencyList *list, int last){
+	const double percentiles[] = { 0.5, 0.9, 0.99, 0.999 };
+	const char *labels[] = { "p50", "p90", "p99", "p999" };
+	uint64_t total = 0;
+	size_t i = 0;
+
+	printf("    \"%s\": {", name);
+
+	if(list->count == 0){
+		printf("}%s\n", last ? "" : ",");
+		return;
+	}
+
+	qsort(list->values, list->count, sizeof(uint64_t), compareLatency);
+	for(i = 0; i < list->count; i++){
+		total += list->values[i];
+	}
+
+	printf("\"min\": %.1f, \"mean\": %.1f", list->values[0] / 1e3, (double)total / list->count / 1e3);
+	for(i = 0; i < 4; i++){
+		printf(", \"%s\": %.1f", labels[i], list->values[(size_t)(percentiles[i] * (list->count - 1))] / 1e3);
+	}
+	printf(", \"max\": %.1f}%s\n", list->values[list->count - 1] / 1e3, last ? "" : ",");
+}
@@ -0,0 +1,610 @@
+/*
+ * Author: John Olgin
+ * Program Name: otp_cipher.c
+ * Date: 10/18/26
+ * Description: This is libotp, the cipher library shared by the daemons, the clients, keygen and otp_local.
+ *	Every kernel is written once, with the direction (encrypt or decrypt) passed in as a constant, and is
+ *	then built twice so the compiler produces a separate, branch free version for each direction. The
+ *	fastest version the CPU supports is picked when otpInit() is called, along with the matching routines
+ *	for packing text into 5 bits per character and back.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "otp_cipher.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+#define ALWAYS_INLINE static inline __attribute__((always_inline))
+
+const char otpCharList[OTP_ALPHABET_SIZE + 1] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ ";
+unsigned char otpCharIndex[256];
+
+// the kernels picked for this CPU by otpInit()
+static otpKernel encryptKernel = NULL;
+static otpKernel decryptKernel = NULL;
+static void (*packRoutine)(const char input[], unsigned char output[], size_t length) = NULL;
+static void (*unpackRoutine)(const unsigned char input[], char output[], size_t length) = NULL;
+static const char *kernelName = "none";
+
+
+/*
+ * Function Name: cipherScalar()
+ * Description: This is the portable kernel. Each input and key character is looked up in the
+ *		character table, the two are added (or subtracted) mod 27 and the result is looked back up
+ *		in the list of available characters. The vector kernels use it for the last few characters.
+ * Preconditions: otpInit() must have filled in the character table. direction must be a constant.
+ * Postconditions: length chars have been written to the output
+ * Returns: none
+*/
+ALWAYS_INLINE void cipherScalar(const char key[], const char input[], char output[], size_t length, const int direction){
+	size_t i = 0;
+
+	for(i = 0; i < length; i++){
+		int value = otpCharIndex[(unsigned char)input[i]];
+		int keyValue = otpCharIndex[(unsigned char)key[i]];
+
+		// only one correction is ever needed to bring the result back into 0-26
+		if(direction == OTP_ENCRYPT){
+			value += keyValue;
+			if(value >= OTP_ALPHABET_SIZE){
+				value -= OTP_ALPHABET_SIZE;
+			}
+		}
+		else{
+			value -= keyValue;
+			if(value < 0){
+				value += OTP_ALPHABET_SIZE;
+			}
+		}
+
+		output[i] = otpCharList[value];
+	}
+}
+
+static void encryptScalar(const char key[], const char input[], char output[], size_t length){
+	cipherScalar(key, input, output, length, OTP_ENCRYPT);
+}
+
+static void decryptScalar(const char key[], const char input[], char output[], size_t length){
+	cipherScalar(key, input, output, length, OTP_DECRYPT);
+}
+
+
+#if defined(__x86_64__) || defined(__i386__)
+
+// The vector kernels turn a character into its index with one saturating step: 'A'-'Z' minus 'A'
+// gives 0-25, and everything else (including the space) wraps around to a large unsigned value
+// that min() clamps down to 26. The index is turned back into a character by adding 'A', except
+// for 26 which becomes a space.
+
+/*
+ * Function Name: cipherSSE2()
+ * Description: This kernel handles 16 characters at a time using SSE2.
+ * Preconditions: The CPU must support SSE2. direction must be a constant.
+ * Postconditions: length chars have been written to the output
+ * Returns: none
+*/
+__attribute__((target("sse2")))
+ALWAYS_INLINE void cipherSSE2(const char key[], const char input[], char output[], size_t length, const int direction){
+	const __m128i letterA = _mm_set1_epi8('A');
+	const __m128i space = _mm_set1_epi8(' ');
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i twentySix = _mm_set1_epi8(26);
+	const __m128i twentySeven = _mm_set1_epi8(27);
+	size_t i = 0;
+
+	for(i = 0; i + 16 <= length; i += 16){
+		__m128i value = _mm_min_epu8(_mm_sub_epi8(_mm_loadu_si128((const __m128i *)(input + i)), letterA), twentySix);
+		__m128i keyValue = _mm_min_epu8(_mm_sub_epi8(_mm_loadu_si128((const __m128i *)(key + i)), letterA), twentySix);
+
+		// add and take 27 back off anything past the end of the list, or subtract and
+		// add 27 back to anything that went negative
+		if(direction == OTP_ENCRYPT){
+			value = _mm_add_epi8(value, keyValue);
+			value = _mm_sub_epi8(value, _mm_and_si128(_mm_cmpgt_epi8(value, twentySix), twentySeven));
+		}
+		else{
+			value = _mm_sub_epi8(value, keyValue);
+			value = _mm_add_epi8(value, _mm_and_si128(_mm_cmpgt_epi8(zero, value), twentySeven));
+		}
+
+		// map back to characters, 26 is the space
+		__m128i isSpace = _mm_cmpeq_epi8(value, twentySix);
+		value = _mm_or_si128(_mm_and_si128(isSpace, space), _mm_andnot_si128(isSpace, _mm_add_epi8(value, letterA)));
+		_mm_storeu_si128((__m128i *)(output + i), value);
+	}
+
+	cipherScalar(key + i, input + i, output + i, length - i, direction);
+}
+
+__attribute__((target("sse2")))
+static void encryptSSE2(const char key[], const char input[], char output[], size_t length){
+	cipherSSE2(key, input, output, length, OTP_ENCRYPT);
+}
+
+__attribute__((target("sse2")))
+static void decryptSSE2(const char key[], const char input[], char output[], size_t length){
+	cipherSSE2(key, input, output, length, OTP_DECRYPT);
+}
+
+
+/*
+ * Function Name: cipherAVX2()
+ * Description: This kernel handles 32 characters at a time using AVX2.
+ * Preconditions: The CPU must support AVX2. direction must be a constant.
+ * Postconditions: length chars have been written to the output
+ * Returns: none
+*/
+__attribute__((target("avx2")))
+ALWAYS_INLINE void cipherAVX2(const char key[], const char input[], char output[], size_t length, const int direction){
+	const __m256i letterA = _mm256_set1_epi8('A');
+	const __m256i space = _mm256_set1_epi8(' ');
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i twentySix = _mm256_set1_epi8(26);
+	const __m256i twentySeven = _mm256_set1_epi8(27);
+	size_t i = 0;
+
+	for(i = 0; i + 32 <= length; i += 32){
+		__m256i value = _mm256_min_epu8(_mm256_sub_epi8(_mm256_loadu_si256((const __m256i *)(input + i)), letterA), twentySix);
+		__m256i keyValue = _mm256_min_epu8(_mm256_sub_epi8(_mm256_loadu_si256((const __m256i *)(key + i)), letterA), twentySix);
+
+		// add and take 27 back off anything past the end of the list, or subtract and
+		// add 27 back to anything that went negative
+		if(direction == OTP_ENCRYPT){
+			value = _mm256_add_epi8(value, keyValue);
+			value = _mm256_sub_epi8(value, _mm256_and_si256(_mm256_cmpgt_epi8(value, twentySix), twentySeven));
+		}
+		else{
+			value = _mm256_sub_epi8(value, keyValue);
+			value = _mm256_add_epi8(value, _mm256_and_si256(_mm256_cmpgt_epi8(zero, value), twentySeven));
+		}
+
+		// map back to characters, 26 is the space
+		value = _mm256_blendv_epi8(_mm256_add_epi8(value, letterA), space, _mm256_cmpeq_epi8(value, twentySix));
+		_mm256_storeu_si256((__m256i *)(output + i), value);
+	}
+
+	cipherScalar(key + i, input + i, output + i, length - i, direction);
+}
+
+__attribute__((target("avx2")))
+static void encryptAVX2(const char key[], const char input[], char output[], size_t length){
+	cipherAVX2(key, input, output, length, OTP_ENCRYPT);
+}
+
+__attribute__((target("avx2")))
+static void decryptAVX2(const char key[], const char input[], char output[], size_t length){
+	cipherAVX2(key, input, output, length, OTP_DECRYPT);
+}
+
+
+/*
+ * Function Name: cipherAVX512()
+ * Description: This kernel handles 64 characters at a time using AVX-512. The last partial block
+ *		is handled with masked loads and stores instead of falling back to the scalar loop.
+ * Preconditions: The CPU must support AVX-512BW. direction must be a constant.
+ * Postconditions: length chars have been written to the output
+ * Returns: none
+*/
+__attribute__((target("avx512f,avx512bw")))
+ALWAYS_INLINE void cipherAVX512(const char key[], const char input[], char output[], size_t length, const int direction){
+	const __m512i letterA = _mm512_set1_epi8('A');
+	const __m512i space = _mm512_set1_epi8(' ');
+	const __m512i zero = _mm512_setzero_si512();
+	const __m512i twentySix = _mm512_set1_epi8(26);
+	const __m512i twentySeven = _mm512_set1_epi8(27);
+	size_t i = 0;
+
+	for(i = 0; i < length; i += 64){
+		__mmask64 lanes = (length - i >= 64) ? ~(__mmask64)0 : (((__mmask64)1 << (length - i)) - 1);
+		__m512i value = _mm512_min_epu8(_mm512_sub_epi8(_mm512_maskz_loadu_epi8(lanes, input + i), letterA), twentySix);
+		__m512i keyValue = _mm512_min_epu8(_mm512_sub_epi8(_mm512_maskz_loadu_epi8(lanes, key + i), letterA), twentySix);
+
+		// add and take 27 back off anything past the end of the list, or subtract and
+		// add 27 back to anything that went negative
+		if(direction == OTP_ENCRYPT){
+			value = _mm512_add_epi8(value, keyValue);
+			value = _mm512_mask_sub_epi8(value, _mm512_cmpgt_epi8_mask(value, twentySix), value, twentySeven);
+		}
+		else{
+			value = _mm512_sub_epi8(value, keyValue);
+			value = _mm512_mask_add_epi8(value, _mm512_cmpgt_epi8_mask(zero, value), value, twentySeven);
+		}
+
+		// map back to characters, 26 is the space
+		value = _mm512_mask_blend_epi8(_mm512_cmpeq_epi8_mask(value, twentySix), _mm512_add_epi8(value, letterA), space);
+		_mm512_mask_storeu_epi8(output + i, lanes, value);
+	}
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static void encryptAVX512(const char key[], const char input[], char output[], size_t length){
+	cipherAVX512(key, input, output, length, OTP_ENCRYPT);
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static void decryptAVX512(const char key[], const char input[], char output[], size_t length){
+	cipherAVX512(key, input, output, length, OTP_DECRYPT);
+}
+
+#endif
+
+
+// Packed text holds each character's index in 5 bits, in groups of 8 characters to 5 bytes. The first
+// character of a group is in the lowest 5 bits of its first byte, and each one after it sits in the
+// next 5 bits up. A last group with fewer than 8 characters only takes as many bytes as its bits fill,
+// with the unused bits left 0. The indexes 27-31 are never packed, and unpack to a space.
+static const char packedChars[32 + 1] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ      ";
+
+
+/*
+ * Function Name: packScalar()
+ * Description: This is the portable packing routine. It builds each group of 8 characters up in a
+ *		64 bit number and writes out its 5 bytes. The vector version uses it for the last few characters.
+ * Preconditions: otpInit() must have filled in the character table.
+ * Postconditions: OTP_PACKED_LENGTH(length) bytes have been written to the output
+ * Returns: none
+*/
+static void packScalar(const char input[], unsigned char output[], size_t length){
+	size_t i = 0;
+	size_t j = 0;
+	size_t count = 0;
+	uint64_t group = 0;
+
+	// the group is read whole before any of it is written, so the output can be the input
+	for(i = 0; i < length; i += 8){
+		count = (length - i < 8) ? length - i : 8;
+		group = 0;
+		for(j = 0; j < count; j++){
+			group |= (uint64_t)otpCharIndex[(unsigned char)input[i + j]] << (5 * j);
+		}
+
+		for(j = 0; j < OTP_PACKED_LENGTH(count); j++){
+			*output++ = group >> (8 * j);
+		}
+	}
+}
+
+
+/*
+ * Function Name: unpackScalar()
+ * Description: This is the portable unpacking routine, which undoes packScalar(). It works from the
+ *		last group back to the first, so the output can be the input.
+ * Preconditions: The input must hold OTP_PACKED_LENGTH(length) bytes.
+ * Postconditions: length chars have been written to the output
+ * Returns: none
+*/
+static void unpackScalar(const unsigned char input[], char output[], size_t length){
+	size_t groupCount = (length + 7) / 8;
+	size_t count = 0;
+	size_t j = 0;
+	uint64_t group = 0;
+
+	while(groupCount > 0){
+		groupCount--;
+		count = (length - 8 * groupCount < 8) ? length - 8 * groupCount : 8;
+
+		group = 0;
+		for(j = 0; j < OTP_PACKED_LENGTH(count); j++){
+			group |= (uint64_t)input[5 * groupCount + j] << (8 * j);
+		}
+
+		for(j = 0; j < count; j++){
+			output[8 * groupCount + j] = packedChars[(group >> (5 * j)) & 0x1f];
+		}
+	}
+}
+
+
+#if defined(__x86_64__) || defined(__i386__)
+
+/*
+ * Function Name: packAVX2()
+ * Description: This routine packs 32 characters at a time using AVX2. The characters are turned into
+ *		indexes the same way the cipher kernels do it, then pairs, pairs of pairs and pairs of those
+ *		are merged by multiplying and shifting until each 64 bit lane holds one 40 bit group. The 5
+ *		bytes of each group are then shuffled together into the 20 bytes that are written out.
+ * Preconditions: The CPU must support AVX2.
+ * Postconditions: OTP_PACKED_LENGTH(length) bytes have been written to the output
+ * Returns: none
+*/
+__attribute__((target("avx2")))
+static void packAVX2(const char input[], unsigned char output[], size_t length){
+	const __m256i letterA = _mm256_set1_epi8('A');
+	const __m256i twentySix = _mm256_set1_epi8(26);
+	const __m256i pairWeights = _mm256_set1_epi16(1 | (32 << 8));
+	const __m256i quadWeights = _mm256_set1_epi32(1 | (1024 << 16));
+	const __m256i lowHalves = _mm256_set1_epi64x(0xffffffff);
+	const __m256i groupBytes = _mm256_setr_epi8(0, 1, 2, 3, 4, 8, 9, 10, 11, 12, -1, -1, -1, -1, -1, -1,
+						    0, 1, 2, 3, 4, 8, 9, 10, 11, 12, -1, -1, -1, -1, -1, -1);
+	size_t i = 0;
+
+	// every 32 characters are read before their 20 bytes are written, so the output can be the input
+	for(i = 0; i + 32 <= length; i += 32){
+		__m256i value = _mm256_min_epu8(_mm256_sub_epi8(_mm256_loadu_si256((const __m256i *)(input + i)), letterA), twentySix);
+		__m128i low;
+		__m128i high;
+		uint32_t lastBytes = 0;
+
+		// 5 bit indexes to 10 bit pairs, 20 bit quads and 40 bit groups
+		value = _mm256_maddubs_epi16(value, pairWeights);
+		value = _mm256_madd_epi16(value, quadWeights);
+		value = _mm256_or_si256(_mm256_and_si256(value, lowHalves), _mm256_slli_epi64(_mm256_srli_epi64(value, 32), 20));
+
+		// each 128 bit half now holds 10 bytes, written out as one 16 byte store and one 4 byte store
+		value = _mm256_shuffle_epi8(value, groupBytes);
+		low = _mm256_castsi256_si128(value);
+		high = _mm256_extracti128_si256(value, 1);
+		lastBytes = _mm_cvtsi128_si32(_mm_srli_si128(high, 6));
+		_mm_storeu_si128((__m128i *)(output + i / 8 * 5), _mm_or_si128(low, _mm_slli_si128(high, 10)));
+		memcpy(output + i / 8 * 5 + 16, &lastBytes, 4);
+	}
+
+	packScalar(input + i, output + i / 8 * 5, length - i);
+}
+
+
+/*
+ * Function Name: unpackAVX2()
+ * Description: This routine unpacks 32 characters at a time using AVX2, undoing packAVX2(). The 5 bytes
+ *		of each group are spread out to their own 64 bit lane, which is split in halves, quarters and
+ *		eighths by shifting and masking until every byte holds one index. Like unpackScalar() it works
+ *		from the end back to the start, so the output can be the input.
+ * Preconditions: The CPU must support AVX2. The input must hold OTP_PACKED_LENGTH(length) bytes.
+ * Postconditions: length chars have been written to the output
+ * Returns: none
+*/
+__attribute__((target("avx2")))
+static void unpackAVX2(const unsigned char input[], char output[], size_t length){
+	const __m256i groupBytes = _mm256_setr_epi8(0, 1, 2, 3, 4, -1, -1, -1, 5, 6, 7, 8, 9, -1, -1, -1,
+						    6, 7, 8, 9, 10, -1, -1, -1, 11, 12, 13, 14, 15, -1, -1, -1);
+	const __m256i lowTwenty = _mm256_set1_epi64x(0xfffff);
+	const __m256i lowTen = _mm256_set1_epi32(0x3ff);
+	const __m256i lowFive = _mm256_set1_epi16(0x1f);
+	const __m256i letterA = _mm256_set1_epi8('A');
+	const __m256i space = _mm256_set1_epi8(' ');
+	const __m256i twentyFive = _mm256_set1_epi8(25);
+	size_t blockCount = length / 32;
+
+	unpackScalar(input + blockCount * 20, output + blockCount * 32, length - blockCount * 32);
+
+	while(blockCount > 0){
+		blockCount--;
+
+		// the second half is loaded 4 bytes in so neither load reads past the block's 20 bytes
+		__m256i value = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)(input + blockCount * 20))),
+							_mm_loadu_si128((const __m128i *)(input + blockCount * 20 + 4)), 1);
+
+		// 40 bit groups to 20 bit quads, 10 bit pairs and 5 bit indexes
+		value = _mm256_shuffle_epi8(value, groupBytes);
+		value = _mm256_or_si256(_mm256_and_si256(value, lowTwenty), _mm256_slli_epi64(_mm256_srli_epi64(value, 20), 32));
+		value = _mm256_or_si256(_mm256_and_si256(value, lowTen), _mm256_slli_epi32(_mm256_srli_epi32(value, 10), 16));
+		value = _mm256_or_si256(_mm256_and_si256(value, lowFive), _mm256_slli_epi16(_mm256_srli_epi16(value, 5), 8));
+
+		// map back to characters, 26 and anything above it is the space
+		value = _mm256_blendv_epi8(_mm256_add_epi8(value, letterA), space, _mm256_cmpgt_epi8(value, twentyFive));
+		_mm256_storeu_si256((__m256i *)(output + blockCount * 32), value);
+	}
+}
+
+#endif
+
+
+/*
+ * Function Name: useKernel()
+ * Description: This function makes one kernel pair the one used by otpEncrypt() and otpDecrypt(), and
+ *		one pair of routines the one used by otpPack() and otpUnpack().
+ * Preconditions: none
+ * Postconditions: The kernels, routines and name are saved
+ * Returns: none
+*/
+static void useKernel(const char *name, otpKernel encryptFunction, otpKernel decryptFunction,
+		      void (*packFunction)(const char[], unsigned char[], size_t), void (*unpackFunction)(const unsigned char[], char[], size_t)){
+	kernelName = name;
+	encryptKernel = encryptFunction;
+	decryptKernel = decryptFunction;
+	packRoutine = packFunction;
+	unpackRoutine = unpackFunction;
+}
+
+
+/*
+ * Function Name: otpInit()
+ * Description: This function fills in the character table and picks the fastest kernels the CPU
+ *		supports, checking for AVX-512, then AVX2, then SSE2, and falling back to the plain table
+ *		driven loop. The OTP_KERNEL environment variable (scalar, sse2, avx2 or avx512) can be set to
+ *		force one of them, which is handy for comparing them.
+ * Preconditions: none
+ * Postconditions: otpEncrypt() and otpDecrypt() are ready to use
+ * Returns: none
+*/
+void otpInit(void){
+	const char *forced = getenv("OTP_KERNEL");
+	int i = 0;
+
+	// every char that isn't in the list is treated like a space, which is also what the
+	// vector kernels end up doing with them
+	for(i = 0; i < 256; i++){
+		otpCharIndex[i] = OTP_ALPHABET_SIZE - 1;
+	}
+	for(i = 0; i < OTP_ALPHABET_SIZE; i++){
+		otpCharIndex[(unsigned char)otpCharList[i]] = i;
+	}
+
+	useKernel("scalar", encryptScalar, decryptScalar, packScalar, unpackScalar);
+
+	if(forced != NULL){
+		otpSelectKernel(forced);
+	}
+	else if(otpSelectKernel("avx512") < 0 && otpSelectKernel("avx2") < 0){
+		otpSelectKernel("sse2");
+	}
+}
+
+
+/*
+ * Function Name: otpSelectKernel()
+ * Description: This function switches otpEncrypt() and otpDecrypt() over to the named kernel, if the
+ *		CPU supports it. The benchmarks use it to time every kernel in one run.
+ * Preconditions: otpInit() must have been called.
+ * Postconditions: The named kernel is in use, or nothing has changed if it isn't available
+ * Returns: 0 on success, -1 if the kernel doesn't exist or the CPU doesn't support it
+*/
+int otpSelectKernel(const char *name){
+	if(strcmp(name, "scalar") == 0){
+		useKernel("scalar", encryptScalar, decryptScalar, packScalar, unpackScalar);
+		return 0;
+	}
+
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_cpu_init();
+
+	// packing has no SSE2 or AVX-512 routine of its own, AVX-512BW CPUs all have AVX2
+
+	if(strcmp(name, "avx512") == 0 && __builtin_cpu_supports("avx512bw")){
+		useKernel("avx512", encryptAVX512, decryptAVX512, packAVX2, unpackAVX2);
+		return 0;
+	}
+	if(strcmp(name, "avx2") == 0 && __builtin_cpu_supports("avx2")){
+		useKernel("avx2", encryptAVX2, decryptAVX2, packAVX2, unpackAVX2);
+		return 0;
+	}
+	if(strcmp(name, "sse2") == 0 && __builtin_cpu_supports("sse2")){
+		useKernel("sse2", encryptSSE2, decryptSSE2, packScalar, unpackScalar);
+		return 0;
+	}
+#endif
+
+	return -1;
+}
+
+
+/*
+ * Function Name: otpKernelName()
+ * Description: This function tells which kernel otpInit() picked.
+ * Preconditions: otpInit() must have been called.
+ * Postconditions: none
+ * Returns: the name of the kernel (scalar, sse2, avx2 or avx512)
+*/
+const char *otpKernelName(void){
+	return kernelName;
+}
+
+
+/*
+ * Function Name: otpEncrypt()
+ * Description: This function encrypts length characters of plain text with the key.
+ * Preconditions: otpInit() must have been called. The key and input must hold at least length chars.
+ * Postconditions: The output holds the encrypted chars, it may be the same array as the input
+ * Returns: none
+*/
+void otpEncrypt(const char key[], const char input[], char output[], size_t length){
+	encryptKernel(key, input, output, length);
+}
+
+
+/*
+ * Function Name: otpDecrypt()
+ * Description: This function decrypts length characters of encrypted text with the key.
+ * Preconditions: otpInit() must have been called. The key and input must hold at least length chars.
+ * Postconditions: The output holds the decrypted chars, it may be the same array as the input
+ * Returns: none
+*/
+void otpDecrypt(const char key[], const char input[], char output[], size_t length){
+	decryptKernel(key, input, output, length);
+}
+
+
+/*
+ * Function Name: otpPack()
+ * Description: This function packs length characters into 5 bits each, 8 characters to every 5 bytes.
+ *		Chars that aren't in the list are packed as a space.
+ * Preconditions: otpInit() must have been called. The output must hold OTP_PACKED_LENGTH(length) bytes.
+ * Postconditions: The output holds the packed chars, it may be the same array as the input
+ * Returns: none
+*/
+void otpPack(const char input[], unsigned char output[], size_t length){
+	packRoutine(input, output, length);
+}
+
+
+/*
+ * Function Name: otpUnpack()
+ * Description: This function unpacks length characters packed by otpPack().
+ * Preconditions: otpInit() must have been called. The input must hold OTP_PACKED_LENGTH(length) bytes
+ *		and the output length chars.
+ * Postconditions: The output holds the chars, it may be the same array as the input
+ * Returns: none
+*/
+void otpUnpack(const unsigned char input[], char output[], size_t length){
+	unpackRoutine(input, output, length);
+}
+
+
+/*
+ * Function Name: otpValidate()
+ * Description: This function will check a string and tell the caller whether or not it contains
+ *		invalid characters, meaning anything other than the uppercase letters and the space.
+ * Preconditions: The array must hold at least length chars.
+ * Postconditions: none
+ * Returns: 0 if every char is valid, -1 if an invalid char was found
+*/
+int otpValidate(const char text[], size_t length){
+	size_t i = 0;
+
+	// iterate through each character in the string
+	for(i = 0; i < length; i++){
+		// if the character has an ASCII value lower or higher than the uppercase
+		// letters' ASCII values, and if the char isn't a space, then return -1 to
+		// signal the existance of an invalid char
+		if((text[i] > 'Z' || text[i] < 'A') && text[i] != ' '){
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+
+/*
+ * Function Name: otpMeasureText()
+ * Description: This function finds the length of the first line of a file a piece at a time, so
+ *		even very long files are never held in memory. It can stop early once a limit is reached
+ *		and can check the characters for validity on the way.
+ * Preconditions: The file must be open for reading at its start. A negative limit means no limit.
+ * Postconditions: The file position is somewhere inside the file and must be rewound to be read again
+ * Returns: the number of characters before the first newline (or the limit if that is reached first),
+ *		or -1 if validation was asked for and an invalid char was found
+*/
+long otpMeasureText(FILE *file, long limit, int validate){
+	char buffer[16384];
+	long totalLength = 0;
+	size_t charsRead = 0;
+
+	while((charsRead = fread(buffer, 1, sizeof(buffer), file)) > 0){
+		char *newline = memchr(buffer, '\n', charsRead);
+		size_t length = (newline == NULL) ? charsRead : (size_t)(newline - buffer);
+
+		// nothing past the limit is counted or checked, so a bad char there can't change the result
+		if(limit >= 0 && length > (size_t)(limit - totalLength)){
+			length = limit - totalLength;
+		}
+
+		if(validate && otpValidate(buffer, length) < 0){
+			return -1;
+		}
+
+		totalLength += length;
+
+		if(newline != NULL || (limit >= 0 && totalLength >= limit)){
+			break;
+		}
+	}
+
+	return totalLength;
+}
@@ -0,0 +1,46 @@
+/*
+ * Author: John Olgin
+ * Program Name: otp_cipher.h
+ * Date: 10/18/26
+ * Description: This is the interface to libotp, the cipher library shared by the daemons, the clients,
+ *	keygen and otp_local. It holds the list of available characters, the table that maps every char to
+ *	its position in that list, the encryption and decryption kernels, and the routines that pack text
+ *	into 5 bits per character for the wire and back.
+*/
+
+#ifndef OTP_CIPHER_H
+#define OTP_CIPHER_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+// the number of characters a message can be made of, A-Z and the space
+#define OTP_ALPHABET_SIZE 27
+
+// the number of bytes length characters take once packed, 5 bits each with the last byte padded out
+#define OTP_PACKED_LENGTH(length) (((length) * 5 + 7) / 8)
+
+// the directions a kernel can be built for
+#define OTP_ENCRYPT 0
+#define OTP_DECRYPT 1
+
+// the list of available characters, and the position of every char in that list. Chars that
+// aren't in the list have the same position as the space.
+extern const char otpCharList[OTP_ALPHABET_SIZE + 1];
+extern unsigned char otpCharIndex[256];
+
+// every kernel reads length chars of input and key and writes length chars of output. The
+// output may be the same array as the input.
+typedef void (*otpKernel)(const char key[], const char input[], char output[], size_t length);
+
+void otpInit(void);
+int otpSelectKernel(const char *name);
+const char *otpKernelName(void);
+void otpEncrypt(const char key[], const char input[], char output[], size_t length);
+void otpDecrypt(const char key[], const char input[], char output[], size_t length);
+void otpPack(const char input[], unsigned char output[], size_t length);
+void otpUnpack(const unsigned char input[], char output[], size_t length);
+int otpValidate(const char text[], size_t length);
+long otpMeasureText(FILE *file, long limit, int validate);
+
+#endif
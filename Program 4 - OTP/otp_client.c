@@ -0,0 +1,1290 @@
+/*
+ * Author: John Olgin
+ * Program Name: otp_client.c
+ * Date: 10/18/26
+ * Description: This is the client code shared by the otp_enc and otp_dec programs. Each client's main()
+ *	hands runClient() a description of its service, which says which operation it asks for and which
+ *	daemon it expects to be talking to, and everything else is the same.
+ *	Any number of text and key pairs can be given on the command line. They are all sent over one
+ *	connection, and up to PIPELINE_DEPTH requests are sent ahead without waiting for their answers. The
+ *	answers come back in the same order and are printed one per line.
+ *	If the port is given as a path (anything containing a '/'), the client connects to a daemon
+ *	listening on a Unix domain socket at that path instead.
+ *	The text and key files are mapped into memory rather than read, and their chunks are handed to the
+ *	socket straight from the mappings, so the only copy made on the way out is the kernel's own. Only
+ *	as much of the key as the text needs is ever mapped or sent.
+ *	With -m the messages are read from a manifest (or stdin) instead, one "text key output" line per
+ *	message, and each result is written to its output file as it arrives. They can be spread over up to
+ *	MAX_CONNECTIONS connections with -c, and -n sets how many requests each may have waiting.
+ *	A text of "-" is read from stdin, so the client can sit in a pipeline. The stream is sent a segment
+ *	(of up to STREAM_SEGMENT characters) at a time as it arrives, each as its own request with the key
+ *	from the same position, and the results are written to stdout as they come back, so memory use
+ *	doesn't grow with the length of the stream.
+ *	A connection the daemon doesn't take within -t seconds (5 by default) is tried again, up to -r more
+ *	times (3 by default), after a wait that doubles every time and is partly random. A connection the
+ *	daemon drops before it has started on an answer is replaced the same way, and the messages it never
+ *	answered are sent again.
+ *	A key given as "@id" or "@id:offset" isn't a file at all but a reference to a pad the daemon holds
+ *	(see the -k option of the daemons). Only the reference is sent, and the daemon reads the key
+ *	straight from its copy of the pad, starting at the offset (0 if none is given).
+ *	With -p every new connection first offers the daemon to pack, and waits for its answer before sending
+ *	anything else. If it agrees, the text and key are packed to 5 bits a character on their way out and
+ *	the results unpacked as they come back, so only 5 bytes cross the wire for every 8 characters. A
+ *	daemon that doesn't pack is used as it is.
+ *	Finding the daemon, connecting to it, the waits between tries, sending the chunks and checking the
+ *	response headers are done by libotpclient, the same way its pools do them (see otp_pool.c).
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <sys/socket.h>
+#include "otp_protocol.h"
+#include "otp_cipher.h"
+#include "otp_pool.h"
+#include "otp_client.h"
+
+// the most requests sent on a connection that haven't been answered yet, unless -n says otherwise
+#define PIPELINE_DEPTH 16
+
+// the most chunks of text (each with its chunk of key) handed to the socket in one call
+#define SEND_CHUNKS 8
+
+// the most connections a batch can be spread over
+#define MAX_CONNECTIONS 64
+
+// how long to wait (in ms) for a connection to the daemon, and how many more tries a connection gets,
+// unless -t and -r say otherwise
+#define CONNECT_TIMEOUT OTP_CONNECT_TIMEOUT
+#define CONNECT_RETRIES OTP_CONNECT_RETRIES
+
+// the most text read from stdin for one request, so a stream never holds more than this (and as much
+// key) for each request waiting for its answer
+#define STREAM_SEGMENT 65536
+
+// receiveResponse() found the daemon hung up, which is worth another try on a new connection
+#define CONNECTION_LOST -2
+
+// one text and key pair from the command line, one line of a batch manifest, or one segment of stdin
+struct otpMessage {
+	const char *textName;
+	const char *keyName;
+	const char *outputName;	// where the result is written, or NULL for stdout
+	char *line;				// the manifest line the names point into, or NULL
+	char *buffer;			// a stdin segment's text followed by its key, or NULL if they're files
+	int newline;			// set if the result ends with a newline, which only a stream's last segment does
+	long textLength;
+	const char *keyId;		// the pad the daemon holds, or NULL if the key is a file
+	size_t keyIdLength;
+	uint64_t keyOffset;
+};
+
+// where the messages come from, either pairs checked up front, a manifest read as it's needed, or stdin
+// read a segment at a time
+struct messageSource {
+	struct otpMessage *messages;
+	int messageCount;
+	int nextMessage;
+	FILE *manifest;
+	long lineNumber;
+	struct otpMessage stream;	// the key of a stdin stream, with keyOffset at the next segment's key
+	int streamFD;			// the stream's key file, or -1
+	int streaming;			// set if the messages come from stdin
+	int waitingForInput;		// set if a connection wanted a segment but stdin had nothing yet
+	int finished;
+};
+
+// everything one connection to the daemon is in the middle of
+struct clientConnection {
+	int socketFD;
+	// the send vector points at the request header (and key reference) and then straight into
+	// the mapped files, a chunk of text followed by the matching chunk of key each time, or into
+	// the pack buffer if the chunks are packed
+	struct iovec sendVector[2 + 2 * SEND_CHUNKS];
+	int vectorCount;
+	int vectorPosition;
+	unsigned char requestHeader[OTP_REQUEST_HEADER_SIZE];
+	unsigned char keyReference[OTP_KEY_REFERENCE_MAX];
+	unsigned char responseHeader[OTP_RESPONSE_HEADER_SIZE];
+	size_t headerRead;
+	struct otpResponse response;
+	uint64_t textReceived;
+	int outputFD;			// the file the oldest waiting message's result goes to, or -1
+	int packed;				// 1 if the daemon agreed to pack on this connection, 0 if not, -1 until it answers the offer
+	int offerSent;			// set once the offer to pack has been queued
+	unsigned char *packBuffer;	// where the queued chunks are packed, if the connection is packed
+	unsigned char heldBytes[5];	// the start of a packed group of the result whose end hasn't arrived
+	size_t heldCount;
+	uint64_t wireReceived;	// how many bytes of a packed result have arrived
+	struct otpMessage *waiting;	// a ring of the messages sent (or being sent) but not answered
+	int depth;				// how many messages the ring holds
+	int waitingFirst;
+	int waitingCount;
+	uint32_t firstRequestId;	// the request id of the oldest waiting message
+	int queuedCount;		// how many of the waiting messages have been (or are being) sent on this connection
+	int sending;			// set while the last of those still has chunks to queue
+	int dropCount;			// how many times the connection has been lost since an answer last arrived
+	long textQueued;
+	const char *text;
+	const char *key;
+	size_t textMapped;
+	size_t keyMapped;
+	int writeClosed;
+};
+
+// the service this client uses, set once by runClient()
+static const struct otpClientService *service = NULL;
+
+// where the daemon is and how hard to try reaching it, also set once by runClient()
+static struct sockaddr_storage daemonSocketAddress;
+static socklen_t daemonSocketAddressLength = 0;
+static int connectTimeout = CONNECT_TIMEOUT;
+static int connectRetries = CONNECT_RETRIES;
+static unsigned int backoffSeed = 0;	// for the random part of the waits
+
+// set by -p, every connection offers the daemon to pack its chunks
+static int packing = 0;
+
+void measureMessage(struct otpMessage *message);
+int readKeyReference(struct otpMessage *message);
+int nextMessage(struct messageSource *source, struct otpMessage *message, int mayWait);
+int readSegment(struct messageSource *source, struct otpMessage *message, int mayWait);
+int openConnection(void);
+int connectDaemon(void);
+int reconnectDaemon(struct clientConnection *conn);
+void backOff(int attempt);
+const char *mapFile(const char *fileName, long length, size_t *mappedLength);
+void unmapFile(const char *map, size_t mappedLength);
+int streamMessages(struct clientConnection connections[], int connectionCount, struct messageSource *source);
+int queueChunks(struct clientConnection *conn, struct messageSource *source);
+int receiveResponse(struct clientConnection *conn);
+int receiveOffer(struct clientConnection *conn);
+ssize_t receivePacked(struct clientConnection *conn, char text[], size_t *textLength);
+void sendChunks(struct clientConnection *conn);
+void finishMessage(struct otpMessage *message);
+
+
+/*
+ * Function Name: runClient()
+ * Description: This function reads the client's command line, checks every text and key pair, connects
+ *		to the daemon and has every pair encrypted or decrypted over that one connection. With -m the
+ *		messages come from a manifest instead, and can be spread over -c connections.
+ * Preconditions: The service must describe the operation and daemon the client uses.
+ * Postconditions: The result of every pair has been printed to stdout (or written to its output file),
+ *		or an error to stderr
+ * Returns: 0 on success, the program exits on any error
+*/
+int runClient(const struct otpClientService *clientService, int argc, char *argv[]){
+
+	// prepare variables to be used in the program
+	// give them all bogus values so I know if they aren't being changed properly
+	const char *manifestName = NULL;
+	char daemonAddress[128];
+	int connectionCount = 1;
+	int depth = PIPELINE_DEPTH;
+	int option = -1;
+	int status = -1;
+	int i = 0;
+	struct messageSource source;
+	struct clientConnection *connections = NULL;
+
+	service = clientService;
+	memset(&source, 0, sizeof(source));
+	source.streamFD = -1;
+
+	// read any options, "-m manifest" reads the messages from a manifest ("-" for stdin), "-c count"
+	// spreads them over that many connections and "-n depth" sets how many requests each connection
+	// can have waiting for an answer
+	// "-t seconds" is how long to wait for the daemon to take a connection, and "-r retries" how many
+	// more times to try if it doesn't, or if it drops the connection before answering
+	// "-p" asks the daemon to take and send the chunks packed
+	while((option = getopt(argc, argv, "m:c:n:t:r:p")) != -1){
+		switch(option){
+			case 'm':
+				manifestName = optarg;
+				break;
+
+			case 'c':
+				connectionCount = atoi(optarg);
+				if(connectionCount < 1 || connectionCount > MAX_CONNECTIONS){
+					fprintf(stderr, "Error: connection count must be from 1 to %d\n", MAX_CONNECTIONS);
+					exit(1);
+				}
+				break;
+
+			case 'n':
+				depth = atoi(optarg);
+				if(depth < 1){
+					fprintf(stderr, "Error: requests in flight must be at least 1\n");
+					exit(1);
+				}
+				break;
+
+			case 't':
+				connectTimeout = (int)(atof(optarg) * 1000);
+				if(connectTimeout < 1){
+					fprintf(stderr, "Error: connect timeout must be at least 0.001 seconds\n");
+					exit(1);
+				}
+				break;
+
+			case 'r':
+				connectRetries = atoi(optarg);
+				if(connectRetries < 0){
+					fprintf(stderr, "Error: retries can't be negative\n");
+					exit(1);
+				}
+				break;
+
+			case 'p':
+				packing = 1;
+				break;
+
+			default:
+				fprintf(stderr, "Usage: %s [-p] [-t seconds] [-r retries] [-n depth] text key [text key ...] port|path\n       %s -m manifest|- [-p] [-c connections] [-t seconds] [-r retries] [-n depth] port|path\n", service->name, service->name);
+				exit(1);
+		}
+	}
+
+	// the packing routines are picked for this CPU the same way the daemons pick their kernels
+	if(packing){
+		otpInit();
+	}
+
+	// ensure the correct number of arguments were provided, one or more text and key pairs
+	// followed by the port, or only the port with a manifest
+	if((manifestName == NULL && (argc - optind < 3 || (argc - optind) % 2 != 1)) || (manifestName != NULL && argc - optind != 1)){
+		fprintf(stderr, "Error: invalid number of arguments\n");
+		exit(1);
+	}
+
+	// the results only stay in order on stdout if there is one connection
+	if(manifestName == NULL && connectionCount > 1){
+		fprintf(stderr, "Error: -c can only be used with -m\n");
+		exit(1);
+	}
+
+
+
+
+	// check every pair before anything is sent, so a bad file is reported
+	// before any output is printed
+	// a manifest is read a line at a time as the connections need more, so it can be any length,
+	// and a text of "-" is read from stdin a segment at a time for the same reason
+	if(manifestName == NULL && strcmp(argv[optind], "-") == 0){
+		if(argc - optind != 3){
+			fprintf(stderr, "Error: stdin can only be used as the only text\n");
+			exit(1);
+		}
+
+		source.streaming = 1;
+		source.stream.textName = "stdin";
+		source.stream.keyName = argv[optind + 1];
+		if(!readKeyReference(&source.stream)){
+			source.streamFD = open(source.stream.keyName, O_RDONLY);
+			if(source.streamFD < 0){
+				fprintf(stderr, "Error: could not open '%s'\n", source.stream.keyName);
+				exit(1);
+			}
+		}
+	}
+	else if(manifestName == NULL){
+		source.messageCount = (argc - optind - 1) / 2;
+		source.messages = calloc(source.messageCount, sizeof(struct otpMessage));
+		if(source.messages == NULL){
+			fprintf(stderr, "Error: out of memory\n");
+			exit(1);
+		}
+
+		for(i = 0; i < source.messageCount; i++){
+			source.messages[i].textName = argv[optind + 2 * i];
+			source.messages[i].keyName = argv[optind + 1 + 2 * i];
+			source.messages[i].newline = 1;
+			measureMessage(&source.messages[i]);
+		}
+	}
+	else{
+		source.manifest = (strcmp(manifestName, "-") == 0) ? stdin : fopen(manifestName, "r");
+		if(source.manifest == NULL){
+			fprintf(stderr, "Error: could not open '%s'\n", manifestName);
+			exit(1);
+		}
+	}
+
+
+
+
+	// a path means the daemon is on a Unix domain socket, anything else is a port on this host (or a
+	// "host:port"), and the host is only looked up once, however many connections are opened to it
+	if(otpResolveAddress(argv[argc - 1], &daemonSocketAddress, &daemonSocketAddressLength) < 0){
+		if(strchr(argv[argc - 1], '/') != NULL){
+			fprintf(stderr, "Error: socket path '%s' is too long\n", argv[argc - 1]);
+			exit(1);
+		}
+
+		// Return an error if a valid host cannot be found
+		fprintf(stderr, "Client error: No host found\n");
+		exit(0);
+	}
+	snprintf(daemonAddress, sizeof(daemonAddress), (daemonSocketAddress.ss_family == AF_UNIX) ? "socket %s" : "port %s", argv[argc - 1]);
+
+	backoffSeed = time(NULL) ^ getpid();
+	connections = calloc(connectionCount, sizeof(struct clientConnection));
+	if(connections == NULL){
+		fprintf(stderr, "Error: out of memory\n");
+		exit(1);
+	}
+
+	for(i = 0; i < connectionCount; i++){
+		connections[i].waiting = calloc(depth, sizeof(struct otpMessage));
+		connections[i].depth = depth;
+		connections[i].outputFD = -1;
+		// room for a packed chunk in every place of the send vector
+		if(packing){
+			connections[i].packBuffer = malloc((2 + 2 * SEND_CHUNKS) * OTP_PACKED_LENGTH(CHUNK_SIZE));
+		}
+		if(connections[i].waiting == NULL || (packing && connections[i].packBuffer == NULL)){
+			fprintf(stderr, "Error: out of memory\n");
+			exit(1);
+		}
+
+		connections[i].packed = packing ? -1 : 0;
+		connections[i].socketFD = openConnection();
+
+		// attempt connection to the accepting server to prepare for data transmission
+		// if connection returns an error, print a text error and exit the program
+		if(connections[i].socketFD < 0){
+			fprintf(stderr, "Error: could not contact %s on %s\n", service->daemonName, daemonAddress);
+			exit(1);
+		}
+	}
+
+
+
+
+	// send every text and key pair to the daemon and print the results
+	// to stdout (or write them to their files) as they come back
+	status = streamMessages(connections, connectionCount, &source);
+
+	// the daemon on the other end must be the right one, per assignment requirement
+	if(status == OTP_STATUS_WRONG_OPERATION || status == OTP_STATUS_BAD_VERSION){
+		fprintf(stderr, "Error: %s cannot use the daemon on %s, it is not %s\n", service->name, daemonAddress, service->daemonName);
+		exit(2);
+	}
+	if(status == OTP_STATUS_NO_KEY){
+		fprintf(stderr, "Error: %s on %s does not hold a pad for every key reference, or one is too short\n", service->daemonName, daemonAddress);
+		exit(1);
+	}
+	if(status != OTP_STATUS_OK){
+		fprintf(stderr, "Error: %s on %s did not return the whole message\n", service->daemonName, daemonAddress);
+		exit(1);
+	}
+
+	// close the sockets for cleanup
+	for(i = 0; i < connectionCount; i++){
+		close(connections[i].socketFD);
+		free(connections[i].waiting);
+		free(connections[i].packBuffer);
+	}
+	free(connections);
+	free(source.messages);
+
+	return 0;
+}
+
+
+/*
+ * Function Name: measureMessage()
+ * Description: This function checks one text and key pair. The text may only hold valid characters and
+ *		the key must be at least as long as the text. Any extra key is never mapped or sent. A key
+ *		reference is only checked for its form here, the daemon checks the pad it names is long enough.
+ * Preconditions: The message must name its text and key files.
+ * Postconditions: The message holds the length of its text, or the program has exited with an error
+ * Returns: none
+*/
+void measureMessage(struct otpMessage *message){
+	const char *text = NULL;
+	const char *key = NULL;
+	const char *newline = NULL;
+	size_t textMapped = 0;
+	size_t keyMapped = 0;
+
+	// map the whole text file, the text ends at its first newline
+	text = mapFile(message->textName, -1, &textMapped);
+	if(text == NULL){
+		fprintf(stderr, "Error: could not open '%s'\n", message->textName);
+		exit(1);
+	}
+
+	newline = memchr(text, '\n', textMapped);
+	message->textLength = (newline == NULL) ? (long)textMapped : newline - text;
+
+	// validate the string doesn't contain any invalid characters
+	// this is per assignment requirement
+	if(otpValidate(text, message->textLength) < 0){
+		fprintf(stderr, "%s error: input contains bad characters\n", service->name);
+		exit(1);
+	}
+
+	// "@id[:offset]" names a pad held by the daemon
+	if(readKeyReference(message)){
+		unmapFile(text, textMapped);
+		return;
+	}
+
+	// only map as much of the key as the text needs
+	key = mapFile(message->keyName, message->textLength, &keyMapped);
+	if(key == NULL){
+		fprintf(stderr, "Error: could not open '%s'\n", message->keyName);
+		exit(1);
+	}
+
+	// if the key string is smaller in length than the text string
+	// then return a text error and exit the program
+	if(keyMapped < (size_t)message->textLength || memchr(key, '\n', message->textLength) != NULL){
+		fprintf(stderr, "Error: key '%s' is too short\n", message->keyName);
+		exit(1);
+	}
+
+	unmapFile(text, textMapped);
+	unmapFile(key, keyMapped);
+}
+
+
+/*
+ * Function Name: nextMessage()
+ * Description: This function hands out the next message to send. Pairs from the command line were
+ *		checked already, manifest lines are read and checked one at a time as they're needed. Every
+ *		manifest line holds a text file, a key file (or key reference) and an output file, separated
+ *		by spaces or tabs. Blank lines are skipped. A stream's next segment is read from stdin.
+ * Preconditions: mayWait must only be set if the caller has nothing else to do in the meantime.
+ * Postconditions: The message has been measured, or the program has exited with an error
+ * Returns: 1 if there was another message, 0 if there wasn't (source->finished says whether there
+ *		will be more)
+*/
+int nextMessage(struct messageSource *source, struct otpMessage *message, int mayWait){
+	char *line = NULL;
+	char *fields[3] = { NULL, NULL, NULL };
+	char *field = NULL;
+	char *position = NULL;
+	size_t capacity = 0;
+	int fieldCount = 0;
+
+	if(source->finished){
+		return 0;
+	}
+
+	if(source->streaming){
+		return readSegment(source, message, mayWait);
+	}
+
+	if(source->manifest == NULL){
+		if(source->nextMessage == source->messageCount){
+			source->finished = 1;
+			return 0;
+		}
+		*message = source->messages[source->nextMessage++];
+		return 1;
+	}
+
+	// each message keeps its own line, since its names point into it
+	while(getline(&line, &capacity, source->manifest) >= 0){
+		source->lineNumber++;
+		fieldCount = 0;
+		for(field = strtok_r(line, " \t\r\n", &position); field != NULL; field = strtok_r(NULL, " \t\r\n", &position)){
+			if(fieldCount < 3){
+				fields[fieldCount] = field;
+			}
+			fieldCount++;
+		}
+
+		if(fieldCount == 0){
+			continue;
+		}
+		if(fieldCount != 3){
+			fprintf(stderr, "Error: manifest line %ld should be: text key output\n", source->lineNumber);
+			exit(1);
+		}
+
+		memset(message, 0, sizeof(struct otpMessage));
+		message->textName = fields[0];
+		message->keyName = fields[1];
+		message->outputName = fields[2];
+		message->line = line;
+		message->newline = 1;
+		measureMessage(message);
+		return 1;
+	}
+
+	free(line);
+	if(source->manifest != stdin){
+		fclose(source->manifest);
+	}
+	source->finished = 1;
+	return 0;
+}
+
+
+/*
+ * Function Name: openConnection()
+ * Description: This function connects to the daemon, trying again after a growing, randomized wait if the
+ *		daemon doesn't take the connection, up to connectRetries more times. The randomness keeps many
+ *		clients turned away at once from all coming back at the same moment.
+ * Preconditions: The daemon's address must be set.
+ * Postconditions: none
+ * Returns: the connected socket, or -1 if the daemon couldn't be reached
+*/
+int openConnection(void){
+	int socketFD = -1;
+	int attempt = 0;
+
+	for(attempt = 0; attempt <= connectRetries; attempt++){
+		if(attempt > 0){
+			backOff(attempt);
+		}
+
+		socketFD = connectDaemon();
+		if(socketFD >= 0){
+			break;
+		}
+	}
+
+	return socketFD;
+}
+
+
+/*
+ * Function Name: connectDaemon()
+ * Description: This function opens a new connection to the daemon, waiting at most connectTimeout ms for
+ *		it. The socket is left non-blocking, every send and receive on it goes through poll() anyway.
+ * Preconditions: The daemon's address must be set.
+ * Postconditions: none
+ * Returns: the connected socket, or -1 if the daemon couldn't be reached in time
+*/
+int connectDaemon(void){
+	struct pollfd pollInfo;
+	int socketFD = otpStartConnect(&daemonSocketAddress, daemonSocketAddressLength);
+
+	if(socketFD < 0){
+		return -1;
+	}
+
+	// a non-blocking connect carries on in the background, poll says when it has finished
+	pollInfo.fd = socketFD;
+	pollInfo.events = POLLOUT;
+	pollInfo.revents = 0;
+
+	if(poll(&pollInfo, 1, connectTimeout) != 1 || otpFinishConnect(socketFD) < 0){
+		close(socketFD);
+		return -1;
+	}
+
+	return socketFD;
+}
+
+
+/*
+ * Function Name: reconnectDaemon()
+ * Description: This function replaces a connection the daemon dropped, and sets every message still
+ *		waiting on it to be sent again on the new one. It gives up if the daemon was already part way
+ *		through an answer, since that part has been written out, or if the connection has been lost
+ *		too many times without an answer arriving.
+ * Preconditions: The connection must have been lost.
+ * Postconditions: The connection is open again with nothing sent on it, or closed
+ * Returns: 0 on success, -1 if the connection can't be replaced
+*/
+int reconnectDaemon(struct clientConnection *conn){
+	close(conn->socketFD);
+	conn->socketFD = -1;
+
+	if(conn->headerRead != 0 || conn->dropCount >= connectRetries){
+		return -1;
+	}
+
+	conn->dropCount++;
+	backOff(conn->dropCount);
+
+	conn->socketFD = openConnection();
+	if(conn->socketFD < 0){
+		return -1;
+	}
+
+	unmapFile(conn->text, conn->textMapped);
+	unmapFile(conn->key, conn->keyMapped);
+	conn->text = NULL;
+	conn->key = NULL;
+	conn->vectorCount = 0;
+	conn->vectorPosition = 0;
+	conn->queuedCount = 0;
+	conn->sending = 0;
+	conn->writeClosed = 0;
+	conn->packed = packing ? -1 : 0;
+	conn->offerSent = 0;
+
+	return 0;
+}
+
+
+/*
+ * Function Name: backOff()
+ * Description: This function waits before another try, for as long as otpBackoffDelay() says. The wait
+ *		doubles with every attempt, and a random amount of up to half of it is taken off.
+ * Preconditions: The first retry is attempt 1.
+ * Postconditions: The wait is over
+ * Returns: none
+*/
+void backOff(int attempt){
+	usleep(otpBackoffDelay(attempt, &backoffSeed) * 1000);
+}
+
+
+/*
+ * Function Name: readSegment()
+ * Description: This function reads the next segment of a stream from stdin, whatever has arrived up to
+ *		STREAM_SEGMENT characters, along with the key for it. The key is read from the key file at the
+ *		same position as the text, or is the same position in the pad a key reference names. Like any
+ *		text, the stream ends at its first newline (or at the end of the input), and its last segment
+ *		is the only one whose result is followed by a newline.
+ * Preconditions: The source must be a stream. Without mayWait, stdin is only read if it's ready.
+ * Postconditions: The segment's text and key are in its buffer (only the text for a key reference), or
+ *		the program has exited with an error if the text has bad characters or the key is too short
+ * Returns: 1 if a segment was read, 0 if stdin had nothing yet
+*/
+int readSegment(struct messageSource *source, struct otpMessage *message, int mayWait){
+	struct pollfd pollInfo;
+	const char *newline = NULL;
+	char *buffer = NULL;
+	ssize_t charsRead = -1;
+
+	// answers may be waiting to be written out, so don't sit on stdin while they are
+	if(!mayWait){
+		pollInfo.fd = STDIN_FILENO;
+		pollInfo.events = POLLIN;
+		pollInfo.revents = 0;
+		if(poll(&pollInfo, 1, 0) == 0){
+			source->waitingForInput = 1;
+			return 0;
+		}
+	}
+
+	buffer = malloc(2 * STREAM_SEGMENT);
+	if(buffer == NULL){
+		fprintf(stderr, "Error: out of memory\n");
+		exit(1);
+	}
+
+	do{
+		charsRead = read(STDIN_FILENO, buffer, STREAM_SEGMENT);
+	} while(charsRead < 0 && errno == EINTR);
+
+	if(charsRead < 0){
+		fprintf(stderr, "Error: could not read stdin\n");
+		exit(1);
+	}
+
+	*message = source->stream;
+	message->buffer = buffer;
+	message->textLength = charsRead;
+	message->newline = 0;
+
+	newline = memchr(buffer, '\n', charsRead);
+	if(newline != NULL || charsRead == 0){
+		message->textLength = (newline != NULL) ? newline - buffer : 0;
+		message->newline = 1;
+		source->finished = 1;
+	}
+
+	// validate the string doesn't contain any invalid characters
+	// this is per assignment requirement
+	if(otpValidate(buffer, message->textLength) < 0){
+		fprintf(stderr, "%s error: input contains bad characters\n", service->name);
+		exit(1);
+	}
+
+	if(message->keyId == NULL){
+		if(pread(source->streamFD, buffer + message->textLength, message->textLength, message->keyOffset) != message->textLength ||
+		   memchr(buffer + message->textLength, '\n', message->textLength) != NULL){
+			fprintf(stderr, "Error: key '%s' is too short\n", message->keyName);
+			exit(1);
+		}
+
+		if(source->finished){
+			close(source->streamFD);
+		}
+	}
+
+	source->stream.keyOffset += message->textLength;
+	return 1;
+}
+
+
+/*
+ * Function Name: readKeyReference()
+ * Description: This function checks whether a message's key is a reference to a pad the daemon holds,
+ *		"@id" or "@id:offset", and if so reads the id and offset out of it.
+ * Preconditions: The message must name its key.
+ * Postconditions: keyId, keyIdLength and keyOffset are set for a reference, or the program has exited
+ *		with an error if the reference is malformed
+ * Returns: 1 if the key is a reference, 0 if it's a file
+*/
+int readKeyReference(struct otpMessage *message){
+	const char *colon = strchr(message->keyName, ':');
+	char *end = NULL;
+
+	if(message->keyName[0] != '@'){
+		return 0;
+	}
+
+	message->keyId = message->keyName + 1;
+	message->keyIdLength = (colon != NULL) ? (size_t)(colon - message->keyId) : strlen(message->keyId);
+	message->keyOffset = 0;
+	if(colon != NULL){
+		message->keyOffset = strtoull(colon + 1, &end, 10);
+	}
+
+	if(message->keyIdLength == 0 || message->keyIdLength > OTP_KEY_ID_MAX ||
+	   (colon != NULL && (end == colon + 1 || *end != '\0' || colon[1] == '-'))){
+		fprintf(stderr, "Error: bad key reference '%s'\n", message->keyName);
+		exit(1);
+	}
+
+	return 1;
+}
+
+
+/*
+ * Function Name: mapFile()
+ * Description: This function maps the start of a file into memory read only. The file itself is closed
+ *		again right away, the mapping stays valid without it.
+ * Preconditions: A negative length maps the whole file.
+ * Postconditions: mappedLength holds the number of bytes mapped, which is less than length if the file
+ *		is shorter
+ * Returns: the mapping, or NULL if the file can't be opened or isn't a regular file
+*/
+const char *mapFile(const char *fileName, long length, size_t *mappedLength){
+	struct stat fileInfo;
+	void *map = NULL;
+	int fileFD = open(fileName, O_RDONLY);
+
+	if(fileFD < 0){
+		return NULL;
+	}
+
+	if(fstat(fileFD, &fileInfo) < 0 || !S_ISREG(fileInfo.st_mode)){
+		close(fileFD);
+		return NULL;
+	}
+
+	*mappedLength = (length < 0 || length > fileInfo.st_size) ? (size_t)fileInfo.st_size : (size_t)length;
+
+	// mmap can't map nothing, an empty file is just an empty string
+	if(*mappedLength == 0){
+		close(fileFD);
+		return "";
+	}
+
+	map = mmap(NULL, *mappedLength, PROT_READ, MAP_PRIVATE, fileFD, 0);
+	close(fileFD);
+	if(map == MAP_FAILED){
+		return NULL;
+	}
+
+	// the file is read front to back once, so let the kernel read ahead
+	madvise(map, *mappedLength, MADV_SEQUENTIAL);
+
+	return map;
+}
+
+
+/*
+ * Function Name: unmapFile()
+ * Description: This function releases a mapping made by mapFile().
+ * Preconditions: The mapping and length must be what mapFile() returned.
+ * Postconditions: The mapping can no longer be used
+ * Returns: none
+*/
+void unmapFile(const char *map, size_t mappedLength){
+	if(map != NULL && mappedLength > 0){
+		munmap((void *)map, mappedLength);
+	}
+}
+
+
+/*
+ * Function Name: streamMessages()
+ * Description: This function sends a request for every message, each a header followed by the text and
+ *		key as interleaved chunks, while it receives the responses coming back and writes them out.
+ *		Sending and receiving are done together with poll() so that neither side can fill up and stall
+ *		the other, on every connection at once. A connection starts its next request as soon as the last
+ *		one is sent, without waiting for its answer, as long as fewer than its depth are still waiting, so
+ *		the messages go to whichever connections are keeping up. Each connection numbers its requests
+ *		from 0, and every response must carry the id of the oldest request still waiting on it. If the
+ *		daemon drops a connection, a new one is opened in its place and the unanswered messages are sent
+ *		again.
+ * Preconditions: Every connection must be connected to the daemon, with room for its depth of messages.
+ * Postconditions: The result of each message and a newline have been written out for every message
+ *		answered before any error
+ * Returns: OTP_STATUS_OK if every message was answered, the status the daemon rejected a request with,
+ *		or -1 if a connection failed
+*/
+int streamMessages(struct clientConnection connections[], int connectionCount, struct messageSource *source){
+	struct pollfd pollInfo[MAX_CONNECTIONS + 1];
+	struct clientConnection *conn = NULL;
+	int activeCount = 0;
+	int status = -1;
+	int i = 0;
+
+	while(1){
+		activeCount = 0;
+		source->waitingForInput = 0;
+
+		for(i = 0; i < connectionCount; i++){
+			conn = &connections[i];
+			if(conn->vectorPosition == conn->vectorCount && queueChunks(conn, source) < 0){
+				return -1;
+			}
+
+			// a connection is finished once there's nothing left to send and every answer is in
+			pollInfo[i].fd = (source->finished && conn->waitingCount == 0) ? -1 : conn->socketFD;
+			pollInfo[i].events = POLLIN;
+			if(conn->vectorPosition < conn->vectorCount){
+				pollInfo[i].events |= POLLOUT;
+			}
+			pollInfo[i].revents = 0;
+
+			if(pollInfo[i].fd >= 0){
+				activeCount++;
+			}
+		}
+
+		if(activeCount == 0){
+			break;
+		}
+
+		// a stream's next segment is sent as soon as it arrives on stdin
+		pollInfo[connectionCount].fd = source->waitingForInput ? STDIN_FILENO : -1;
+		pollInfo[connectionCount].events = POLLIN;
+		pollInfo[connectionCount].revents = 0;
+
+		// wait until the daemon has sent something back or can take more
+		if(poll(pollInfo, connectionCount + 1, -1) < 0){
+			return -1;
+		}
+
+		for(i = 0; i < connectionCount; i++){
+			if(pollInfo[i].revents & (POLLIN | POLLHUP | POLLERR)){
+				status = receiveResponse(&connections[i]);
+
+				// a busy daemon may turn a connection away, so the unanswered
+				// messages get another go on a new one
+				if(status == CONNECTION_LOST){
+					if(reconnectDaemon(&connections[i]) < 0){
+						return -1;
+					}
+					continue;
+				}
+				if(status != OTP_STATUS_OK){
+					return status;
+				}
+			}
+
+			if(pollInfo[i].revents & POLLOUT){
+				sendChunks(&connections[i]);
+			}
+		}
+	}
+
+	// a full disk may only show up once the last of the result is flushed
+	if(fflush(stdout) == EOF || ferror(stdout)){
+		fprintf(stderr, "Error: could not write the result to stdout\n");
+		exit(1);
+	}
+
+	return OTP_STATUS_OK;
+}
+
+
+/*
+ * Function Name: queueChunks()
+ * Description: This function fills a connection's send vector once the last of it has been sent. When the
+ *		message being sent has no chunks left, the next message is started, and then its header and as
+ *		many chunks as fit are queued.
+ * Preconditions: Everything the send vector held must have been sent.
+ * Postconditions: The send vector holds whatever the connection should send next, which may be nothing
+ * Returns: 0, or -1 if a file changed since it was measured
+*/
+int queueChunks(struct clientConnection *conn, struct messageSource *source){
+	struct otpMessage *message = NULL;
+	struct otpRequest request;
+	unsigned char *packed = NULL;
+	size_t chunkLength = 0;
+
+	conn->vectorCount = 0;
+	conn->vectorPosition = 0;
+
+	// the offer to pack goes out on its own as an empty request, and nothing else is sent until the
+	// answer says how to send it
+	if(conn->packed < 0){
+		if(!conn->offerSent){
+			request.magic = OTP_MAGIC;
+			request.version = OTP_VERSION;
+			request.operation = service->operation;
+			request.flags = OTP_FLAG_PACKED;
+			request.requestId = conn->firstRequestId;
+			request.payloadLength = 0;
+			request.keyLength = 0;
+			packRequest(&request, conn->requestHeader);
+
+			conn->sendVector[0].iov_base = conn->requestHeader;
+			conn->sendVector[0].iov_len = OTP_REQUEST_HEADER_SIZE;
+			conn->vectorCount = 1;
+			conn->offerSent = 1;
+		}
+		return 0;
+	}
+
+	// the files aren't needed once the last of their chunks has been sent
+	if(conn->sending){
+		message = &conn->waiting[(conn->waitingFirst + conn->queuedCount - 1) % conn->depth];
+		if(conn->textQueued == message->textLength){
+			unmapFile(conn->text, conn->textMapped);
+			unmapFile(conn->key, conn->keyMapped);
+			conn->text = NULL;
+			conn->key = NULL;
+			conn->sending = 0;
+		}
+	}
+
+	// once a message is sent, take on the next one unless too many are
+	// still waiting for their answers
+	if(!conn->sending && conn->queuedCount == conn->waitingCount && conn->waitingCount < conn->depth &&
+	   nextMessage(source, &conn->waiting[(conn->waitingFirst + conn->waitingCount) % conn->depth], conn->waitingCount == 0)){
+		conn->waitingCount++;
+	}
+
+	// start on the oldest message not sent yet, which after a lost connection is one that was
+	// sent on the old connection but never answered
+	if(!conn->sending && conn->queuedCount < conn->waitingCount){
+		message = &conn->waiting[(conn->waitingFirst + conn->queuedCount) % conn->depth];
+
+		request.magic = OTP_MAGIC;
+		request.version = OTP_VERSION;
+		request.operation = service->operation;
+		request.flags = conn->packed ? OTP_FLAG_PACKED : 0;
+		request.requestId = conn->firstRequestId + conn->queuedCount;
+		request.payloadLength = message->textLength;
+		request.keyLength = message->textLength;
+
+		conn->queuedCount++;
+		conn->sending = 1;
+		conn->textQueued = 0;
+
+		conn->sendVector[0].iov_base = conn->requestHeader;
+		conn->sendVector[0].iov_len = OTP_REQUEST_HEADER_SIZE;
+		conn->vectorCount = 1;
+
+		// a key reference goes right behind the header, in place of the key chunks
+		if(message->keyId != NULL){
+			request.flags |= OTP_FLAG_KEY_ID;
+			request.keyLength = packKeyReference(message->keyId, message->keyIdLength, message->keyOffset, conn->keyReference);
+			conn->sendVector[1].iov_base = conn->keyReference;
+			conn->sendVector[1].iov_len = request.keyLength;
+			conn->vectorCount = 2;
+		}
+		packRequest(&request, conn->requestHeader);
+
+		// a stream segment is already in memory, with its key right behind it
+		if(message->buffer != NULL){
+			conn->text = message->buffer;
+			conn->key = (message->keyId == NULL) ? message->buffer + message->textLength : NULL;
+			conn->textMapped = 0;
+			conn->keyMapped = 0;
+		}
+		// the key is trimmed to the text's length just by mapping no more of it
+		else{
+			conn->text = mapFile(message->textName, message->textLength, &conn->textMapped);
+			if(conn->text == NULL || conn->textMapped != (size_t)message->textLength){
+				return -1;
+			}
+
+			conn->keyMapped = 0;
+			conn->key = NULL;
+			if(message->keyId == NULL){
+				conn->key = mapFile(message->keyName, message->textLength, &conn->keyMapped);
+				if(conn->key == NULL || conn->keyMapped != (size_t)message->textLength){
+					return -1;
+				}
+			}
+		}
+	}
+
+	// queue the next chunks, right behind the header if a request was just
+	// started so both go out together
+	// packed chunks are packed into the pack buffer one after another, which is free again
+	// since everything queued last time has been sent
+	packed = conn->packBuffer;
+	while(conn->sending && conn->textQueued < message->textLength && conn->vectorCount + 2 <= 2 + 2 * SEND_CHUNKS){
+		chunkLength = (message->textLength - conn->textQueued < CHUNK_SIZE) ? message->textLength - conn->textQueued : CHUNK_SIZE;
+
+		conn->sendVector[conn->vectorCount].iov_base = (char *)conn->text + conn->textQueued;
+		conn->sendVector[conn->vectorCount].iov_len = chunkLength;
+		if(conn->packed){
+			otpPack(conn->text + conn->textQueued, packed, chunkLength);
+			conn->sendVector[conn->vectorCount].iov_base = packed;
+			conn->sendVector[conn->vectorCount].iov_len = OTP_PACKED_LENGTH(chunkLength);
+			packed += OTP_PACKED_LENGTH(chunkLength);
+		}
+		conn->vectorCount++;
+
+		if(conn->key != NULL){
+			conn->sendVector[conn->vectorCount].iov_base = (char *)conn->key + conn->textQueued;
+			conn->sendVector[conn->vectorCount].iov_len = chunkLength;
+			if(conn->packed){
+				otpPack(conn->key + conn->textQueued, packed, chunkLength);
+				conn->sendVector[conn->vectorCount].iov_base = packed;
+				conn->sendVector[conn->vectorCount].iov_len = OTP_PACKED_LENGTH(chunkLength);
+				packed += OTP_PACKED_LENGTH(chunkLength);
+			}
+			conn->vectorCount++;
+		}
+
+		conn->textQueued += chunkLength;
+	}
+
+	// call shutdown once everything is sent so the server knows no more is coming
+	// credit: https://stackoverflow.com/questions/34751399/non-terminating-while-loop-while-using-recv
+	// the answers are read until the last one is in, so there's no need to wait here
+	if(conn->vectorCount == 0 && !conn->sending && conn->queuedCount == conn->waitingCount && source->finished && conn->writeClosed == 0){
+		shutdown(conn->socketFD, SHUT_WR);
+		conn->writeClosed = 1;
+	}
+
+	return 0;
+}
+
+
+/*
+ * Function Name: receiveResponse()
+ * Description: This function reads what the daemon has sent back on a connection. Each response header
+ *		comes first and says whether the daemon accepted the request, then its result is written to
+ *		stdout or the message's output file as it arrives, followed by a newline.
+ * Preconditions: The connection must have a message waiting for its answer.
+ * Postconditions: The oldest waiting message is finished if the last of its result arrived
+ * Returns: OTP_STATUS_OK, the status the daemon rejected a request with, CONNECTION_LOST if the daemon
+ *		hung up, or -1 if the answer isn't the one expected
+*/
+int receiveResponse(struct clientConnection *conn){
+	static char recvBuffer[CHUNK_SIZE];
+	struct otpMessage *message = &conn->waiting[conn->waitingFirst];
+	size_t recvLength = 0;
+	ssize_t charsRead = -1;
+	int status = -1;
+
+	// the answer to the offer to pack comes before any other
+	if(conn->packed < 0){
+		return receiveOffer(conn);
+	}
+
+	if(conn->waitingCount == 0){
+		return -1;
+	}
+
+	if(conn->headerRead < OTP_RESPONSE_HEADER_SIZE){
+		charsRead = recv(conn->socketFD, conn->responseHeader + conn->headerRead, OTP_RESPONSE_HEADER_SIZE - conn->headerRead, MSG_DONTWAIT);
+		if(charsRead > 0){
+			conn->headerRead += charsRead;
+			if(conn->headerRead == OTP_RESPONSE_HEADER_SIZE){
+				status = otpCheckResponse(conn->responseHeader, &conn->response, conn->firstRequestId, message->textLength);
+				if(status != OTP_STATUS_OK){
+					return status;
+				}
+				if((conn->response.flags & OTP_FLAG_PACKED) != (conn->packed ? OTP_FLAG_PACKED : 0)){
+					return -1;
+				}
+				conn->textReceived = 0;
+				conn->wireReceived = 0;
+				conn->heldCount = 0;
+
+				if(message->outputName != NULL){
+					conn->outputFD = open(message->outputName, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+					if(conn->outputFD < 0){
+						fprintf(stderr, "Error: could not write '%s'\n", message->outputName);
+						exit(1);
+					}
+				}
+			}
+		}
+	}
+	// write out whatever text has come back, but never read into the next response
+	else{
+		if(conn->packed){
+			charsRead = receivePacked(conn, recvBuffer, &recvLength);
+		}
+		else{
+			recvLength = (conn->response.length - conn->textReceived < sizeof(recvBuffer)) ? conn->response.length - conn->textReceived : sizeof(recvBuffer);
+			charsRead = recv(conn->socketFD, recvBuffer, recvLength, MSG_DONTWAIT);
+			recvLength = (charsRead > 0) ? (size_t)charsRead : 0;
+		}
+
+		if(recvLength > 0){
+			if(conn->outputFD < 0){
+				if(fwrite(recvBuffer, 1, recvLength, stdout) != recvLength){
+					fprintf(stderr, "Error: could not write the result to stdout\n");
+					exit(1);
+				}
+			}
+			else if(write(conn->outputFD, recvBuffer, recvLength) != (ssize_t)recvLength){
+				fprintf(stderr, "Error: could not write '%s'\n", message->outputName);
+				exit(1);
+			}
+			conn->textReceived += recvLength;
+		}
+	}
+
+	// the daemon hung up before every answer arrived
+	if(charsRead == 0 || (charsRead < 0 && errno != EAGAIN && errno != EINTR)){
+		return CONNECTION_LOST;
+	}
+
+	// the newline isn't part of the message on the wire
+	if(conn->headerRead == OTP_RESPONSE_HEADER_SIZE && conn->textReceived == conn->response.length){
+		if(conn->outputFD < 0){
+			if(message->newline){
+				if(fputc('\n', stdout) == EOF){
+					fprintf(stderr, "Error: could not write the result to stdout\n");
+					exit(1);
+				}
+			}
+		}
+		else{
+			if(write(conn->outputFD, "\n", 1) != 1 || close(conn->outputFD) < 0){
+				fprintf(stderr, "Error: could not write '%s'\n", message->outputName);
+				exit(1);
+			}
+			conn->outputFD = -1;
+		}
+
+		finishMessage(message);
+		conn->headerRead = 0;
+		conn->waitingFirst = (conn->waitingFirst + 1) % conn->depth;
+		conn->waitingCount--;
+		conn->queuedCount--;
+		conn->dropCount = 0;
+		conn->firstRequestId++;
+	}
+
+	return OTP_STATUS_OK;
+}
+
+
+/*
+ * Function Name: receiveOffer()
+ * Description: This function reads the daemon's answer to the offer to pack. A daemon that packs sets the
+ *		packed flag in it, one that doesn't know about packing answers the empty request without it.
+ * Preconditions: The offer must have been queued on the connection.
+ * Postconditions: The connection is packed or not once the whole answer is in
+ * Returns: OTP_STATUS_OK, the status the daemon rejected the offer with, CONNECTION_LOST if the daemon
+ *		hung up, or -1 if the answer isn't the one expected
+*/
+int receiveOffer(struct clientConnection *conn){
+	ssize_t charsRead = recv(conn->socketFD, conn->responseHeader + conn->headerRead, OTP_RESPONSE_HEADER_SIZE - conn->headerRead, MSG_DONTWAIT);
+	int status = -1;
+
+	if(charsRead == 0 || (charsRead < 0 && errno != EAGAIN && errno != EINTR)){
+		conn->headerRead = 0;
+		return CONNECTION_LOST;
+	}
+	if(charsRead < 0){
+		return OTP_STATUS_OK;
+	}
+
+	conn->headerRead += charsRead;
+	if(conn->headerRead < OTP_RESPONSE_HEADER_SIZE){
+		return OTP_STATUS_OK;
+	}
+
+	conn->headerRead = 0;
+	status = otpCheckResponse(conn->responseHeader, &conn->response, conn->firstRequestId, 0);
+	if(status != OTP_STATUS_OK){
+		return status;
+	}
+
+	conn->packed = (conn->response.flags & OTP_FLAG_PACKED) ? 1 : 0;
+	return OTP_STATUS_OK;
+}
+
+
+/*
+ * Function Name: receivePacked()
+ * Description: This function reads what has arrived of a packed result and unpacks it. Only whole groups
+ *		of 5 bytes (8 characters) can be unpacked until the last of the result is in, so the bytes of a
+ *		group that's been cut short are held on the connection until the rest of it arrives.
+ * Preconditions: The connection must be packed, and the response header must have been read.
+ * Postconditions: textLength holds the number of characters unpacked into text, which has room for
+ *		CHUNK_SIZE of them
+ * Returns: what recv() returned
+*/
+ssize_t receivePacked(struct clientConnection *conn, char text[], size_t *textLength){
+	static unsigned char packedBuffer[OTP_PACKED_LENGTH(CHUNK_SIZE)];
+	uint64_t wireLength = OTP_PACKED_LENGTH(conn->response.length);
+	size_t recvLength = sizeof(packedBuffer) - conn->heldCount;
+	size_t packedLength = 0;
+	ssize_t charsRead = -1;
+
+	if(wireLength - conn->wireReceived < recvLength){
+		recvLength = wireLength - conn->wireReceived;
+	}
+
+	*textLength = 0;
+	memcpy(packedBuffer, conn->heldBytes, conn->heldCount);
+	charsRead = recv(conn->socketFD, packedBuffer + conn->heldCount, recvLength, MSG_DONTWAIT);
+	if(charsRead <= 0){
+		return charsRead;
+	}
+
+	conn->wireReceived += charsRead;
+	packedLength = conn->heldCount + charsRead;
+	*textLength = (conn->wireReceived == wireLength) ? conn->response.length - conn->textReceived : packedLength / 5 * 8;
+	otpUnpack(packedBuffer, text, *textLength);
+
+	conn->heldCount = packedLength - OTP_PACKED_LENGTH(*textLength);
+	memcpy(conn->heldBytes, packedBuffer + packedLength - conn->heldCount, conn->heldCount);
+
+	return charsRead;
+}
+
+
+/*
+ * Function Name: sendChunks()
+ * Description: This function sends as much of a connection's queued chunks as the socket will take.
+ * Preconditions: The socket must be ready for writing.
+ * Postconditions: The send vector has been stepped past whatever was sent
+ * Returns: none
+*/
+void sendChunks(struct clientConnection *conn){
+	otpSendVector(conn->socketFD, conn->sendVector, &conn->vectorPosition, conn->vectorCount);
+}
+
+
+/*
+ * Function Name: finishMessage()
+ * Description: This function releases anything a message read from a manifest or stdin holds.
+ * Preconditions: none
+ * Postconditions: The message's names can no longer be used
+ * Returns: none
+*/
+void finishMessage(struct otpMessage *message){
+	free(message->line);
+	free(message->buffer);
+	message->line = NULL;
+	message->buffer = NULL;
+}
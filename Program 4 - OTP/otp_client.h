@@ -0,0 +1,20 @@
+/*
+ * Author: John Olgin
+ * Program Name: otp_client.h
+ * Date: 10/18/26
+ * Description: This is the interface to the client code shared by the otp_enc and otp_dec programs.
+*/
+
+#ifndef OTP_CLIENT_H
+#define OTP_CLIENT_H
+
+// what makes one client different from the other
+struct otpClientService {
+	const char *name;		// the client's name, for messages
+	const char *daemonName;	// the daemon the client has to talk to, for messages
+	int operation;			// the request operation the client sends (OTP_OP_ENCRYPT or OTP_OP_DECRYPT)
+};
+
+int runClient(const struct otpClientService *clientService, int argc, char *argv[]);
+
+#endif
@@ -0,0 +1,2373 @@
+/*
+ * Author: John Olgin
+ * Program Name: otp_daemon.c
+ * Date: 10/18/26
+ * Description: This is the serving code shared by the otp_enc_d and otp_dec_d daemons. Each daemon's main()
+ *	hands runDaemon() a description of its service, which says which operation it answers and which libotp
+ *	kernel it uses, and everything else (the serving modes, the protocol, the connection handling) is the same.
+ *	By default a new process is forked for every connection. When started with "-w workers", a pool of
+ *	long-lived worker processes is forked up front instead, and each worker accepts and serves many
+ *	connections over its lifetime. Workers that die are replaced by the parent. When started with "-e",
+ *	a single process serves every connection from an epoll loop with non-blocking sockets instead.
+ *	When started with "-t threads", one process runs an acceptor thread that hands each connection to
+ *	a fixed pool of worker threads through a bounded queue ("-q size"). Connections that arrive while
+ *	the queue is full are turned away, and SIGUSR1 prints how many were accepted, queued and rejected.
+ *	When started with "-u", a single thread serves every connection through io_uring instead of epoll,
+ *	with a multishot accept, receives into registered buffers and linked sends, so many requests cost
+ *	only one system call. If the kernel can't do that the daemon falls back to the epoll loop. In both
+ *	of the single thread modes SIGUSR1 prints how many requests and system calls have been made.
+ *	When started with "-s shards", the daemon runs that many copies of the chosen mode (one per core for
+ *	"-s 0"), each with its own SO_REUSEPORT listen socket on the port and pinned to its own core, so the
+ *	kernel balances new connections over them. "-b backlog" sets the listen backlog of every socket.
+ *	When started with "-k directory", every pad in the directory (as written by keygen) is mapped into
+ *	memory and indexed by its file name, and clients can send a reference to one of them in place of a key.
+ *	A request can ask for its chunks to be packed, 5 bits to a character. The daemon unpacks each chunk in
+ *	its buffer before running the cipher over it, and packs the result in place again before sending it.
+ *	If the listening port is given as a path (anything containing a '/'), the daemon listens on a Unix
+ *	domain socket at that path instead of a TCP port, for clients running on the same host.
+*/
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sched.h>
+#include <sys/wait.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <linux/io_uring.h>
+#include "otp_protocol.h"
+#include "otp_cipher.h"
+#include "otp_daemon.h"
+
+#define MAX_EVENTS 64
+#define DEFAULT_QUEUE_SIZE 64
+
+// the io_uring loop's ring sizes, and how many connections it can serve at once from registered buffers.
+// Every connection starts on a small slot that holds chunks of up to URING_SMALL_CHUNK characters, moves
+// to one of the fewer large slots while it's sent longer messages, and goes back once they fit again.
+#define URING_ENTRIES 256
+#define URING_CQ_ENTRIES 4096
+#define URING_SLOTS 512
+#define URING_LARGE_SLOTS 64
+#define URING_SMALL_CHUNK 2048
+#define URING_TAG_MASK 7
+
+// what each io_uring completion is for, kept in the low bits of its user_data next to the connection
+enum uringTag { URING_ACCEPT, URING_SIGNAL, URING_CLOSE, URING_HEADER, URING_PAYLOAD, URING_KEY, URING_RESPONSE, URING_RESULT };
+
+// the steps a connection moves through in the epoll serving mode
+enum connectionState { READING_HEADER, READING_KEY_ID, READING_PAYLOAD, READING_KEY, COMPUTING, WRITING };
+
+// everything the epoll and io_uring loops need to remember about one client between events
+struct connection {
+	int socketFD;
+	enum connectionState state;
+	unsigned int events;
+	unsigned char header[OTP_REQUEST_HEADER_SIZE];
+	size_t headerLength;
+	struct otpRequest request;
+	unsigned char reference[OTP_KEY_REFERENCE_MAX];
+	size_t referenceLength;
+	size_t referenceRead;
+	const char *storedKey;	// the next key characters in a stored pad, or NULL if the client sends the key
+	unsigned char response[OTP_RESPONSE_HEADER_SIZE];
+	size_t responseSent;
+	int closeAfterWrite;
+	uint64_t remaining;
+	char *text;		// the chunk buffers, in one allocation (or a registered slot) with the key after the text
+	char *key;
+	size_t bufferSize;
+	size_t chunkLength;
+	size_t wireLength;	// the bytes the chunk takes on the wire, fewer than chunkLength if it's packed
+	size_t textLength;
+	size_t keyLength;
+	size_t resultSent;
+	int slot;		// the io_uring loop's registered buffer slot, -1 if the buffers are allocated
+	int pending;	// io_uring operations still in flight
+	int failed;
+};
+
+// one pad from the key directory
+struct storedPad {
+	char *id;
+	const char *pad;
+	size_t length;
+};
+
+// the io_uring rings, mapped from the kernel by setupUring()
+struct uringRing {
+	int ringFD;
+	unsigned int entries;
+	unsigned int *sqHead;
+	unsigned int *sqTail;
+	unsigned int *sqMask;
+	unsigned int *sqArray;
+	struct io_uring_sqe *sqes;
+	unsigned int sqLocalTail;
+	unsigned int sqSubmitted;
+	unsigned int *cqHead;
+	unsigned int *cqTail;
+	unsigned int *cqMask;
+	struct io_uring_cqe *cqes;
+};
+
+// the registered buffers one io_uring connection receives and computes its chunks in
+struct uringSlot {
+	char text[URING_SMALL_CHUNK];
+	char key[URING_SMALL_CHUNK];
+};
+
+struct uringLargeSlot {
+	char text[CHUNK_SIZE];
+	char key[CHUNK_SIZE];
+};
+
+// everything registered with the kernel, slot numbers past URING_SLOTS are the large slots
+struct uringBuffers {
+	struct uringSlot small[URING_SLOTS];
+	struct uringLargeSlot large[URING_LARGE_SLOTS];
+};
+
+// the serving mode and listen socket settings read from the command line
+struct daemonOptions {
+	int workerCount;	// -w, pre-forked worker processes
+	int threadCount;	// -t, worker threads
+	int queueSize;		// -q, connections allowed to wait for a worker thread
+	int useEpoll;		// -e
+	int useUring;		// -u
+	int shardCount;		// -s, SO_REUSEPORT shards (0 for one per core, -1 for no sharding)
+	int backlog;		// -b, the listen backlog
+	const char *keyDirectory;	// -k, the directory of pads clients can refer to by id
+};
+
+// the chunk buffers one worker serves all of its connections with
+struct workerBuffers {
+	char text[CHUNK_SIZE];
+	char key[CHUNK_SIZE];
+};
+
+// the bounded queue the acceptor thread hands connections to the worker threads through
+struct connectionQueue {
+	pthread_mutex_t lock;
+	pthread_cond_t notEmpty;
+	int *sockets;
+	int size;
+	int head;
+	int count;
+	int peak;
+	unsigned long accepted;
+	unsigned long rejected;
+	unsigned long served;
+};
+
+// the service this daemon provides, set once by runDaemon()
+static const struct otpService *service = NULL;
+
+// what the single thread loops have done, for SIGUSR1
+static unsigned long requestCount = 0;
+static unsigned long syscallCount = 0;
+
+// the io_uring loop's registered buffers and which of them are free
+static struct uringBuffers *uringBuffers = NULL;
+static int freeSlots[URING_SLOTS];
+static int freeSlotCount = 0;
+static int freeLargeSlots[URING_LARGE_SLOTS];
+static int freeLargeSlotCount = 0;
+static struct signalfd_siginfo uringSignal;
+
+// the pads from the key directory, sorted by id
+static struct storedPad *storedPads = NULL;
+static int storedPadCount = 0;
+
+void removeStaleSocket(const struct sockaddr_un *socketAddress);
+int openListenSocket(const struct sockaddr *address, socklen_t addressLength, int reusePort, int backlog);
+void serveConnections(int listenSocketFD, const struct daemonOptions *options);
+void runShardedServer(const struct sockaddr_in *serverAddress, const struct daemonOptions *options);
+pid_t spawnShard(const int listenSocketFDs[], int shardCount, int shardIndex, int cpu, const struct daemonOptions *options);
+void loadKeyDirectory(const char *directoryName);
+int comparePads(const void *a, const void *b);
+int findStoredKey(const unsigned char reference[], size_t referenceLength, uint64_t payloadLength, const char **key);
+void checkTerminatedProcesses(int signalFD);
+void handleConnection(int estabSocketFD, struct workerBuffers *buffers);
+void runForkServer(int listenSocketFD);
+void runPreforkServer(int listenSocketFD, int workerCount);
+pid_t spawnWorker(int listenSocketFD);
+void runWorker(int listenSocketFD);
+void runThreadServer(int listenSocketFD, int threadCount, int queueSize);
+void *runThreadWorker(void *argument);
+void reportQueue(struct connectionQueue *queue);
+int openReportSignal(void);
+void reportSyscalls(void);
+int runUringServer(int listenSocketFD);
+int setupUring(struct uringRing *ring);
+struct io_uring_sqe *getSqe(struct uringRing *ring);
+int submitUring(struct uringRing *ring, unsigned int waitCount);
+void queueAccept(struct uringRing *ring, int listenSocketFD, int multishot);
+void queueSignal(struct uringRing *ring, int signalFD);
+void startUringConnection(struct uringRing *ring, int estabSocketFD);
+void queueConnection(struct uringRing *ring, struct connection *conn);
+void completeUringConnection(struct uringRing *ring, struct connection *conn, int tag, int result);
+void closeUringConnection(struct uringRing *ring, struct connection *conn);
+void runEpollServer(int listenSocketFD);
+void acceptConnections(int listenSocketFD, int epollFD);
+int serviceConnection(int epollFD, struct connection *conn);
+int readConnection(struct connection *conn);
+int startRequest(struct connection *conn);
+int answerRequest(struct connection *conn, int status);
+int sizeBuffers(struct connection *conn, size_t size);
+void startChunk(struct connection *conn);
+void computeConnection(struct connection *conn);
+int writeConnection(struct connection *conn);
+void closeConnection(int epollFD, struct connection *conn);
+int checkRequest(const struct otpRequest *request);
+
+
+/*
+ * Function Name: runDaemon()
+ * Description: This function reads the daemon's command line, sets up the listen socket (or one per
+ *		shard) and then serves connections in the mode that was asked for.
+ * Preconditions: The service must describe the operation and kernel the daemon provides.
+ * Postconditions: none, the daemon serves until it is killed
+ * Returns: never returns, a usage or setup error exits with a status of 1
+*/
+int runDaemon(const struct otpService *daemonService, int argc, char *argv[]){
+
+	// prepare variables to be used in the program
+	// give them all bogus values so I know if they aren't being changed properly
+	int listenSocketFD = -1;
+	int portNumber = -1;
+	const char *socketPath = NULL;
+	int option = -1;
+	struct daemonOptions options = { 0, 0, DEFAULT_QUEUE_SIZE, 0, 0, -1, SOMAXCONN, NULL };
+
+	// prepare structs to hold information regarding the connection between
+	// the two processes, only one of them is used
+	struct sockaddr_in serverAddress;
+	struct sockaddr_un socketAddress;
+
+	service = daemonService;
+
+
+
+	// read any options, "-w workers" selects the pre-forked worker pool, "-t threads" selects
+	// the worker thread pool (with "-q size" connections allowed to wait for a thread) and
+	// "-e" selects the single process epoll loop ("-u" the same with io_uring)
+	// "-s shards" runs that many copies of the chosen mode, each on its own socket and core,
+	// and "-b backlog" sets how many connections can wait to be accepted on each socket
+	// "-k directory" loads the pads clients can refer to instead of sending a key
+	while((option = getopt(argc, argv, "w:t:q:eus:b:k:")) != -1){
+		switch(option){
+			case 'w':
+				options.workerCount = atoi(optarg);
+				if(options.workerCount < 1){
+					fprintf(stderr, "Error: worker count must be at least 1\n");
+					exit(1);
+				}
+				break;
+
+			case 't':
+				options.threadCount = atoi(optarg);
+				if(options.threadCount < 1){
+					fprintf(stderr, "Error: thread count must be at least 1\n");
+					exit(1);
+				}
+				break;
+
+			case 'q':
+				options.queueSize = atoi(optarg);
+				if(options.queueSize < 1){
+					fprintf(stderr, "Error: queue size must be at least 1\n");
+					exit(1);
+				}
+				break;
+
+			case 'e':
+				options.useEpoll = 1;
+				break;
+
+			case 'u':
+				options.useUring = 1;
+				break;
+
+			case 's':
+				options.shardCount = atoi(optarg);
+				if(options.shardCount < 0){
+					fprintf(stderr, "Error: shard count can't be negative\n");
+					exit(1);
+				}
+				break;
+
+			case 'b':
+				options.backlog = atoi(optarg);
+				if(options.backlog < 1){
+					fprintf(stderr, "Error: backlog must be at least 1\n");
+					exit(1);
+				}
+				break;
+
+			case 'k':
+				options.keyDirectory = optarg;
+				break;
+
+			default:
+				fprintf(stderr, "Usage: %s [-w workers | -t threads [-q queue_size] | -e | -u] [-s shards] [-b backlog] [-k key_directory] listening_port|socket_path\n", service->name);
+				exit(1);
+		}
+	}
+
+	// only one serving mode can be used at a time
+	if(options.useEpoll + options.useUring + (options.workerCount > 0) + (options.threadCount > 0) > 1){
+		fprintf(stderr, "Error: only one of -w, -t, -e and -u can be used\n");
+		exit(1);
+	}
+
+	// Ensure the correct number of arguments were provided
+	if(argc - optind != 1){
+		fprintf(stderr, "Incorrect number of arguments\n");
+		exit(1);
+	}
+
+
+
+	// set all the server address variables to be used in the connection
+	// clear the structs first to ensure that they're truly empty
+	memset((char *)&serverAddress, '\0', sizeof(serverAddress));
+	memset((char *)&socketAddress, '\0', sizeof(socketAddress));
+
+	// a path means a Unix domain socket, anything else is a TCP port
+	if(strchr(argv[optind], '/') != NULL){
+		socketPath = argv[optind];
+		if(strlen(socketPath) >= sizeof(socketAddress.sun_path)){
+			fprintf(stderr, "Error: socket path '%s' is too long\n", socketPath);
+			exit(1);
+		}
+		socketAddress.sun_family = AF_UNIX;
+		strcpy(socketAddress.sun_path, socketPath);
+	}
+	else{
+		portNumber = atoi(argv[optind]);
+		serverAddress.sin_family = AF_INET;
+		serverAddress.sin_port = htons(portNumber);
+		serverAddress.sin_addr.s_addr = INADDR_ANY;
+	}
+
+	// the kernel can only spread connections over several sockets on one TCP port
+	if(options.shardCount >= 0 && socketPath != NULL){
+		fprintf(stderr, "Error: -s can only be used with a TCP port\n");
+		exit(1);
+	}
+
+
+
+	// a client that hangs up early shouldn't kill the process sending to it
+	signal(SIGPIPE, SIG_IGN);
+
+	// pick the cipher kernel once, before any workers are forked
+	otpInit();
+
+	// the pads are mapped once here and shared by every process and thread that serves
+	if(options.keyDirectory != NULL){
+		loadKeyDirectory(options.keyDirectory);
+	}
+
+	if(options.shardCount >= 0){
+		runShardedServer(&serverAddress, &options);
+	}
+
+	// a socket file left behind by an earlier daemon would make the bind fail, so remove it first
+	if(socketPath != NULL){
+		removeStaleSocket(&socketAddress);
+		listenSocketFD = openListenSocket((struct sockaddr*)&socketAddress, sizeof(socketAddress), 0, options.backlog);
+	}
+	else{
+		listenSocketFD = openListenSocket((struct sockaddr*)&serverAddress, sizeof(serverAddress), 0, options.backlog);
+	}
+
+	serveConnections(listenSocketFD, &options);
+
+	return 0;
+}
+
+
+/*
+ * Function Name: removeStaleSocket()
+ * Description: This function clears the socket path for the daemon to bind to. A socket file left
+ *		behind by a daemon that has stopped would make the bind fail, so it's removed. Anything else at
+ *		the path is left alone, whether it's not a socket at all or a socket another daemon is still
+ *		listening on, and the daemon exits instead.
+ * Preconditions: The address must hold the socket path.
+ * Postconditions: Nothing is at the path, or the daemon has exited with an error
+ * Returns: none
+*/
+void removeStaleSocket(const struct sockaddr_un *socketAddress){
+	struct stat fileInfo;
+	int testSocketFD = -1;
+
+	if(lstat(socketAddress->sun_path, &fileInfo) < 0){
+		if(errno == ENOENT){
+			return;
+		}
+		perror("Error: could not check the socket path");
+		exit(1);
+	}
+
+	if(!S_ISSOCK(fileInfo.st_mode)){
+		fprintf(stderr, "Error: '%s' already exists and isn't a socket\n", socketAddress->sun_path);
+		exit(1);
+	}
+
+	// only a socket nothing is listening on any more refuses the connection
+	testSocketFD = socket(AF_UNIX, SOCK_STREAM, 0);
+	if(testSocketFD < 0){
+		perror("Error: socket creation failed");
+		exit(1);
+	}
+
+	if(connect(testSocketFD, (const struct sockaddr *)socketAddress, sizeof(struct sockaddr_un)) == 0){
+		fprintf(stderr, "Error: another daemon is already listening on '%s'\n", socketAddress->sun_path);
+		exit(1);
+	}
+	if(errno != ECONNREFUSED){
+		perror("Error: could not check the socket path");
+		exit(1);
+	}
+
+	close(testSocketFD);
+	unlink(socketAddress->sun_path);
+}
+
+
+/*
+ * Function Name: openListenSocket()
+ * Description: This function creates a socket, binds it to the address and starts listening on it.
+ *		With reusePort set, other sockets can be bound to the same port with it and the kernel
+ *		spreads incoming connections over all of them.
+ * Preconditions: The address must be filled in.
+ * Postconditions: The socket is listening, or the daemon has exited with an error
+ * Returns: the listen socket
+*/
+int openListenSocket(const struct sockaddr *address, socklen_t addressLength, int reusePort, int backlog){
+	int listenSocketFD = -1;
+	int enable = 1;
+
+	// set up the listen socket to listen for incoming client connections
+	// also, check if the socket was properly initialized
+	listenSocketFD = socket(address->sa_family, SOCK_STREAM, 0);
+	if(listenSocketFD < 0){
+		perror("Error: socket creation failed");
+		exit(1);
+	}
+
+	if(reusePort && setsockopt(listenSocketFD, SOL_SOCKET, SO_REUSEPORT, &enable, sizeof(enable)) < 0){
+		perror("Error: could not set SO_REUSEPORT");
+		exit(1);
+	}
+
+	// bind the socket and ensure that the socket was successfully bound
+	if(bind(listenSocketFD, address, addressLength) < 0){
+		perror("Error: binding failed");
+		exit(1);
+	}
+
+	// start listening on the socket to prepare for incoming connections
+	// the kernel quietly caps the backlog at net.core.somaxconn
+	if(listen(listenSocketFD, backlog) < 0){
+		perror("Error: listen failed");
+		exit(1);
+	}
+
+	return listenSocketFD;
+}
+
+
+/*
+ * Function Name: serveConnections()
+ * Description: This function serves connections on a listen socket in the mode that was asked for.
+ * Preconditions: The listen socket must be bound and listening.
+ * Postconditions: none, the daemon serves until it is killed
+ * Returns: none
+*/
+void serveConnections(int listenSocketFD, const struct daemonOptions *options){
+	// serve connections until the daemon is killed
+	// the io_uring loop only returns if the kernel can't run it, and then epoll takes over
+	if(options->useUring){
+		runUringServer(listenSocketFD);
+		fprintf(stderr, "%s: io_uring is not available, using epoll instead\n", service->name);
+		runEpollServer(listenSocketFD);
+	}
+	else if(options->useEpoll){
+		runEpollServer(listenSocketFD);
+	}
+	else if(options->workerCount > 0){
+		runPreforkServer(listenSocketFD, options->workerCount);
+	}
+	else if(options->threadCount > 0){
+		runThreadServer(listenSocketFD, options->threadCount, options->queueSize);
+	}
+	else{
+		runForkServer(listenSocketFD);
+	}
+}
+
+
+/*
+ * Function Name: runShardedServer()
+ * Description: This function splits the daemon into shards, one per core by default ("-s 0"). Every
+ *		shard gets its own SO_REUSEPORT listen socket on the port, so the kernel spreads new
+ *		connections over the shards instead of them all queuing on one socket, and each shard is a
+ *		process pinned to its own core running the chosen serving mode. The sockets are all opened
+ *		here in the parent, so a bad port is reported once, and a shard that dies is replaced by a
+ *		new one on the same socket and core without losing the connections waiting on it.
+ * Preconditions: The address must be a TCP address.
+ * Postconditions: none, the loop runs until the daemon is killed
+ * Returns: none
+*/
+void runShardedServer(const struct sockaddr_in *serverAddress, const struct daemonOptions *options){
+	int shardCount = options->shardCount;
+	int *listenSocketFDs = NULL;
+	int *cpus = NULL;
+	int cpuCount = 0;
+	int cpu = 0;
+	int i = 0;
+	int exitMethod = -5;
+	pid_t exitPID = -5;
+	pid_t *shardPIDs = NULL;
+	cpu_set_t allowed;
+
+	// the cores this daemon is allowed to run on, in order
+	if(sched_getaffinity(0, sizeof(allowed), &allowed) < 0){
+		perror("Error: could not read the CPU affinity");
+		exit(1);
+	}
+
+	cpus = malloc(CPU_SETSIZE * sizeof(int));
+	if(cpus == NULL){
+		fprintf(stderr, "Error: out of memory\n");
+		exit(1);
+	}
+
+	for(cpu = 0; cpu < CPU_SETSIZE; cpu++){
+		if(CPU_ISSET(cpu, &allowed)){
+			cpus[cpuCount++] = cpu;
+		}
+	}
+
+	if(shardCount == 0){
+		shardCount = cpuCount;
+	}
+
+	listenSocketFDs = malloc(shardCount * sizeof(int));
+	shardPIDs = malloc(shardCount * sizeof(pid_t));
+	if(listenSocketFDs == NULL || shardPIDs == NULL){
+		fprintf(stderr, "Error: out of memory\n");
+		exit(1);
+	}
+
+	for(i = 0; i < shardCount; i++){
+		listenSocketFDs[i] = openListenSocket((const struct sockaddr*)serverAddress, sizeof(*serverAddress), 1, options->backlog);
+	}
+
+	// more shards than cores share the cores round robin
+	for(i = 0; i < shardCount; i++){
+		shardPIDs[i] = spawnShard(listenSocketFDs, shardCount, i, cpus[i % cpuCount], options);
+	}
+
+	// block until a shard dies, then put a new one in its place
+	while(1){
+		exitPID = waitpid(-1, &exitMethod, 0);
+
+		for(i = 0; i < shardCount && exitPID > 0; i++){
+			if(shardPIDs[i] == exitPID){
+				shardPIDs[i] = spawnShard(listenSocketFDs, shardCount, i, cpus[i % cpuCount], options);
+			}
+		}
+	}
+}
+
+
+/*
+ * Function Name: spawnShard()
+ * Description: This function forks one shard. The shard closes every listen socket but its own,
+ *		pins itself to its core and serves its socket in the chosen mode. If the fork fails it keeps
+ *		trying once a second, like spawnWorker().
+ * Preconditions: Every shard's listen socket must be bound and listening.
+ * Postconditions: A new shard process is serving listenSocketFDs[shardIndex]
+ * Returns: the pid of the new shard
+*/
+pid_t spawnShard(const int listenSocketFDs[], int shardCount, int shardIndex, int cpu, const struct daemonOptions *options){
+	pid_t childID = fork();
+	cpu_set_t pinned;
+	int i = 0;
+
+	while(childID == -1){
+		perror("Error: failed to spawn shard");
+		sleep(1);
+		childID = fork();
+	}
+
+	if(childID != 0){
+		return childID;
+	}
+
+	for(i = 0; i < shardCount; i++){
+		if(i != shardIndex){
+			close(listenSocketFDs[i]);
+		}
+	}
+
+	// the shard and everything it forks or starts stays on this core
+	CPU_ZERO(&pinned);
+	CPU_SET(cpu, &pinned);
+	if(sched_setaffinity(0, sizeof(pinned), &pinned) < 0){
+		perror("Error: could not pin shard");
+	}
+
+	serveConnections(listenSocketFDs[shardIndex], options);
+	exit(0);
+}
+
+
+/*
+ * Function Name: runForkServer()
+ * Description: This is the original serving loop. It accepts connections one at a time and
+ *		forks a new child process to serve each one. Finished children are reaped when their
+ *		SIGCHLD arrives, which is read from a signalfd alongside the listen socket, so the loop
+ *		never has to sleep or poll for them.
+ * Preconditions: The listen socket must be bound and listening.
+ * Postconditions: none, the loop runs until the daemon is killed
+ * Returns: none
+*/
+void runForkServer(int listenSocketFD){
+	// every child gets its own copy of the buffers when it's forked
+	static struct workerBuffers buffers;
+	int estabSocketFD = -1;
+	int signalFD = -1;
+	sigset_t childSignal;
+	sigset_t oldMask;
+	struct pollfd pollInfo[2];
+
+	socklen_t sizeOfClientInfo;
+	struct sockaddr_storage clientAddress;
+
+	// SIGCHLD is blocked so it's only ever delivered through the signalfd
+	sigemptyset(&childSignal);
+	sigaddset(&childSignal, SIGCHLD);
+	if(sigprocmask(SIG_BLOCK, &childSignal, &oldMask) < 0){
+		perror("Error: could not block SIGCHLD");
+		exit(1);
+	}
+
+	signalFD = signalfd(-1, &childSignal, SFD_NONBLOCK | SFD_CLOEXEC);
+	if(signalFD < 0){
+		perror("Error: signalfd creation failed");
+		exit(1);
+	}
+
+	// start primary loop to accept connections
+	while(1){
+		// wait for a new connection or for a child process to end
+		pollInfo[0].fd = listenSocketFD;
+		pollInfo[0].events = POLLIN;
+		pollInfo[1].fd = signalFD;
+		pollInfo[1].events = POLLIN;
+
+		if(poll(pollInfo, 2, -1) < 0){
+			if(errno != EINTR){
+				perror("Error: poll failed");
+			}
+			continue;
+		}
+
+		// check for any child processes that have ended
+		if(pollInfo[1].revents & POLLIN){
+			checkTerminatedProcesses(signalFD);
+		}
+
+		if(!(pollInfo[0].revents & POLLIN)){
+			continue;
+		}
+
+		// save the size of the struct holding the client address
+		sizeOfClientInfo = sizeof(clientAddress);
+
+		// accept any incoming connections from clients
+		estabSocketFD = accept(listenSocketFD, (struct sockaddr*)&clientAddress, &sizeOfClientInfo);
+
+
+		// check that a client connection was properly accepted
+		// Do this prior to any data transmission to ensure stability
+		if(estabSocketFD < 0){
+			fprintf(stderr, "Error: error on accept\n");
+		}
+
+
+
+		// Only fork() child if a proper connection is accepted by the server
+		if(estabSocketFD >= 0){
+
+			// start a new process to do the actual work
+			int childID = fork();
+
+			switch(childID){
+				// return error if a process isn't spawned correctly and exit
+				case -1:
+					perror("Error: failed to spawn process");
+					exit(1);
+					break;
+
+				// Start of child process code
+				case 0:
+					// the child doesn't need the parent's signal handling
+					close(signalFD);
+					sigprocmask(SIG_SETMASK, &oldMask, NULL);
+
+					handleConnection(estabSocketFD, &buffers);
+
+					// exit the child process
+					exit(0);
+
+				// This is the parent process code
+				default:
+					// the child owns the connection now
+					close(estabSocketFD);
+			}
+		}
+	}
+}
+
+
+/*
+ * Function Name: runPreforkServer()
+ * Description: This function forks a fixed pool of worker processes that all accept on the
+ *		shared listen socket. The parent then only waits on the workers and forks a
+ *		replacement whenever one of them dies, so the pool always stays at full size.
+ * Preconditions: The listen socket must be bound and listening, and workerCount must be positive.
+ * Postconditions: none, the loop runs until the daemon is killed
+ * Returns: none
+*/
+void runPreforkServer(int listenSocketFD, int workerCount){
+	int i = 0;
+	int exitMethod = -5;
+	pid_t exitPID = -5;
+
+	// start the initial pool of workers
+	for(i = 0; i < workerCount; i++){
+		spawnWorker(listenSocketFD);
+	}
+
+	// block until a worker dies, then put a new one in its place
+	while(1){
+		exitPID = waitpid(-1, &exitMethod, 0);
+
+		if(exitPID > 0){
+			spawnWorker(listenSocketFD);
+		}
+	}
+}
+
+
+/*
+ * Function Name: spawnWorker()
+ * Description: This function forks a single worker process for the pre-forked pool. If the fork
+ *		fails it keeps trying once a second rather than letting the pool shrink.
+ * Preconditions: The listen socket must be bound and listening.
+ * Postconditions: A new worker process is running runWorker()
+ * Returns: the pid of the new worker
+*/
+pid_t spawnWorker(int listenSocketFD){
+	pid_t childID = fork();
+
+	while(childID == -1){
+		perror("Error: failed to spawn worker");
+		sleep(1);
+		childID = fork();
+	}
+
+	// the child becomes a worker and never returns
+	if(childID == 0){
+		runWorker(listenSocketFD);
+		exit(0);
+	}
+
+	return childID;
+}
+
+
+/*
+ * Function Name: runWorker()
+ * Description: This is the loop run by each pre-forked worker. It accepts a connection from the
+ *		shared listen socket, serves it in this same process and then goes back to
+ *		accept the next one. The kernel hands each connection to only one waiting worker.
+ * Preconditions: The listen socket must be bound and listening.
+ * Postconditions: none, the loop runs until the worker is killed
+ * Returns: none
+*/
+void runWorker(int listenSocketFD){
+	// the same buffers are used for every connection this worker serves
+	static struct workerBuffers buffers;
+	int estabSocketFD = -1;
+
+	socklen_t sizeOfClientInfo;
+	struct sockaddr_storage clientAddress;
+
+	while(1){
+		// save the size of the struct holding the client address
+		sizeOfClientInfo = sizeof(clientAddress);
+
+		// accept the next incoming connection from a client
+		estabSocketFD = accept(listenSocketFD, (struct sockaddr*)&clientAddress, &sizeOfClientInfo);
+
+		if(estabSocketFD < 0){
+			fprintf(stderr, "Error: error on accept\n");
+			continue;
+		}
+
+		handleConnection(estabSocketFD, &buffers);
+	}
+}
+
+
+/*
+ * Function Name: runThreadServer()
+ * Description: This function starts a fixed pool of worker threads and then becomes the acceptor.
+ *		Each accepted connection is put on a bounded queue for the next free worker. If the queue
+ *		is already full the connection is closed straight away, so a burst of clients can't pile up
+ *		an unbounded backlog behind busy workers. A SIGUSR1 is read from a signalfd alongside the
+ *		listen socket and prints the queue's counts to stderr.
+ * Preconditions: The listen socket must be bound and listening, threadCount and queueSize must be positive.
+ * Postconditions: none, the loop runs until the daemon is killed
+ * Returns: none
+*/
+void runThreadServer(int listenSocketFD, int threadCount, int queueSize){
+	struct connectionQueue queue;
+	pthread_t thread;
+	int estabSocketFD = -1;
+	int signalFD = -1;
+	int i = 0;
+	struct pollfd pollInfo[2];
+
+	memset(&queue, 0, sizeof(queue));
+	pthread_mutex_init(&queue.lock, NULL);
+	pthread_cond_init(&queue.notEmpty, NULL);
+	queue.size = queueSize;
+	queue.sockets = malloc(queueSize * sizeof(int));
+	if(queue.sockets == NULL){
+		fprintf(stderr, "Error: could not allocate the connection queue\n");
+		exit(1);
+	}
+
+	// SIGUSR1 is blocked before any threads start so they all inherit the mask
+	signalFD = openReportSignal();
+
+	// start the pool of workers, they never exit so nothing waits on them
+	for(i = 0; i < threadCount; i++){
+		if(pthread_create(&thread, NULL, runThreadWorker, &queue) != 0){
+			fprintf(stderr, "Error: failed to start worker thread\n");
+			exit(1);
+		}
+		pthread_detach(thread);
+	}
+
+	while(1){
+		// wait for a new connection or for a report to be asked for
+		pollInfo[0].fd = listenSocketFD;
+		pollInfo[0].events = POLLIN;
+		pollInfo[1].fd = signalFD;
+		pollInfo[1].events = POLLIN;
+
+		if(poll(pollInfo, 2, -1) < 0){
+			if(errno != EINTR){
+				perror("Error: poll failed");
+			}
+			continue;
+		}
+
+		if(pollInfo[1].revents & POLLIN){
+			struct signalfd_siginfo signalInfo;
+
+			if(read(signalFD, &signalInfo, sizeof(signalInfo)) == sizeof(signalInfo)){
+				reportQueue(&queue);
+			}
+		}
+
+		if(!(pollInfo[0].revents & POLLIN)){
+			continue;
+		}
+
+		estabSocketFD = accept(listenSocketFD, NULL, NULL);
+		if(estabSocketFD < 0){
+			fprintf(stderr, "Error: error on accept\n");
+			continue;
+		}
+
+		// queue the connection for a worker, or turn it away if too many are already waiting
+		pthread_mutex_lock(&queue.lock);
+		if(queue.count == queue.size){
+			queue.rejected++;
+			pthread_mutex_unlock(&queue.lock);
+			close(estabSocketFD);
+			continue;
+		}
+
+		queue.sockets[(queue.head + queue.count) % queue.size] = estabSocketFD;
+		queue.count++;
+		queue.accepted++;
+		if(queue.count > queue.peak){
+			queue.peak = queue.count;
+		}
+		pthread_cond_signal(&queue.notEmpty);
+		pthread_mutex_unlock(&queue.lock);
+	}
+}
+
+
+/*
+ * Function Name: runThreadWorker()
+ * Description: This is the loop run by each worker thread. It takes the oldest connection off the
+ *		queue, serves it and goes back for the next one. The chunk buffers are allocated once
+ *		when the thread starts and used for every connection it serves.
+ * Preconditions: The argument must point at the queue set up by runThreadServer().
+ * Postconditions: none, the loop runs until the daemon is killed
+ * Returns: never returns
+*/
+void *runThreadWorker(void *argument){
+	struct connectionQueue *queue = argument;
+	struct workerBuffers *buffers = malloc(sizeof(struct workerBuffers));
+	int estabSocketFD = -1;
+
+	if(buffers == NULL){
+		fprintf(stderr, "Error: could not allocate worker buffers\n");
+		exit(1);
+	}
+
+	while(1){
+		pthread_mutex_lock(&queue->lock);
+		while(queue->count == 0){
+			pthread_cond_wait(&queue->notEmpty, &queue->lock);
+		}
+
+		estabSocketFD = queue->sockets[queue->head];
+		queue->head = (queue->head + 1) % queue->size;
+		queue->count--;
+		pthread_mutex_unlock(&queue->lock);
+
+		handleConnection(estabSocketFD, buffers);
+
+		pthread_mutex_lock(&queue->lock);
+		queue->served++;
+		pthread_mutex_unlock(&queue->lock);
+	}
+
+	return NULL;
+}
+
+
+/*
+ * Function Name: reportQueue()
+ * Description: This function prints the connection queue's counts to stderr: connections accepted
+ *		onto the queue, served to completion, rejected because the queue was full, waiting right
+ *		now, and the most that have ever been waiting at once.
+ * Preconditions: The queue must have been set up by runThreadServer().
+ * Postconditions: One line has been printed to stderr
+ * Returns: none
+*/
+void reportQueue(struct connectionQueue *queue){
+	pthread_mutex_lock(&queue->lock);
+	fprintf(stderr, "%s: accepted %lu served %lu rejected %lu queued %d peak %d of %d\n", service->name,
+		queue->accepted, queue->served, queue->rejected, queue->count, queue->peak, queue->size);
+	pthread_mutex_unlock(&queue->lock);
+}
+
+
+/*
+ * Function Name: openReportSignal()
+ * Description: This function blocks SIGUSR1 and opens a signalfd for it, so a request for the
+ *		daemon's counts is read by the serving loop like any other event instead of interrupting it.
+ *		The signalfd is left blocking since it's only read once it's known to be ready.
+ * Preconditions: none
+ * Postconditions: SIGUSR1 is blocked in the calling thread and any threads it starts later
+ * Returns: the signalfd
+*/
+int openReportSignal(void){
+	sigset_t reportSignal;
+	int signalFD = -1;
+
+	sigemptyset(&reportSignal);
+	sigaddset(&reportSignal, SIGUSR1);
+	if(sigprocmask(SIG_BLOCK, &reportSignal, NULL) < 0){
+		perror("Error: could not block SIGUSR1");
+		exit(1);
+	}
+
+	signalFD = signalfd(-1, &reportSignal, SFD_CLOEXEC);
+	if(signalFD < 0){
+		perror("Error: signalfd creation failed");
+		exit(1);
+	}
+
+	return signalFD;
+}
+
+
+/*
+ * Function Name: reportSyscalls()
+ * Description: This function prints how many requests the single thread loops have answered and how
+ *		many system calls they made to do it, which is what the io_uring loop is meant to cut down.
+ * Preconditions: none
+ * Postconditions: One line has been printed to stderr
+ * Returns: none
+*/
+void reportSyscalls(void){
+	fprintf(stderr, "%s: requests %lu syscalls %lu (%.2f per request)\n", service->name, requestCount, syscallCount,
+		(requestCount > 0) ? (double)syscallCount / requestCount : 0.0);
+}
+
+
+/*
+ * Function Name: runEpollServer()
+ * Description: This is the event driven serving loop. A single process keeps every client
+ *		connection open at once on non-blocking sockets and uses epoll to find out which ones
+ *		are ready. Each connection carries its own state (reading the header, reading the payload,
+ *		reading the key, computing, writing) so a slow client never holds up any of the others.
+ * Preconditions: The listen socket must be bound and listening.
+ * Postconditions: none, the loop runs until the daemon is killed
+ * Returns: none
+*/
+void runEpollServer(int listenSocketFD){
+	struct epoll_event event;
+	struct epoll_event events[MAX_EVENTS];
+	struct signalfd_siginfo signalInfo;
+	int epollFD = -1;
+	int signalFD = openReportSignal();
+	int readyCount = -1;
+	int i = 0;
+
+	// the listen socket has to be non-blocking too so accepting can't stall the loop
+	fcntl(listenSocketFD, F_SETFL, fcntl(listenSocketFD, F_GETFL, 0) | O_NONBLOCK);
+
+	epollFD = epoll_create1(0);
+	if(epollFD < 0){
+		perror("Error: epoll creation failed");
+		exit(1);
+	}
+
+	// the listen socket is the only entry that doesn't point at a connection
+	memset(&event, 0, sizeof(event));
+	event.events = EPOLLIN;
+	event.data.ptr = NULL;
+	if(epoll_ctl(epollFD, EPOLL_CTL_ADD, listenSocketFD, &event) < 0){
+		perror("Error: epoll_ctl failed");
+		exit(1);
+	}
+
+	// and the signalfd is marked by pointing at where its signal is read into
+	event.data.ptr = &signalInfo;
+	if(epoll_ctl(epollFD, EPOLL_CTL_ADD, signalFD, &event) < 0){
+		perror("Error: epoll_ctl failed");
+		exit(1);
+	}
+
+	while(1){
+		readyCount = epoll_wait(epollFD, events, MAX_EVENTS, -1);
+		syscallCount++;
+
+		if(readyCount < 0){
+			if(errno != EINTR){
+				perror("Error: epoll_wait failed");
+			}
+			continue;
+		}
+
+		for(i = 0; i < readyCount; i++){
+			struct connection *conn = events[i].data.ptr;
+
+			if(conn == NULL){
+				acceptConnections(listenSocketFD, epollFD);
+			}
+			else if(events[i].data.ptr == &signalInfo){
+				if(read(signalFD, &signalInfo, sizeof(signalInfo)) == sizeof(signalInfo)){
+					reportSyscalls();
+				}
+			}
+			else if(serviceConnection(epollFD, conn) != 0){
+				closeConnection(epollFD, conn);
+			}
+		}
+	}
+}
+
+
+/*
+ * Function Name: acceptConnections()
+ * Description: This function accepts every connection that is waiting on the listen socket, makes
+ *		each one non-blocking and registers it with epoll in the reading header state.
+ * Preconditions: The listen socket must be non-blocking and registered with the epoll instance.
+ * Postconditions: All pending connections are being watched by epoll
+ * Returns: none
+*/
+void acceptConnections(int listenSocketFD, int epollFD){
+	struct epoll_event event;
+	int estabSocketFD = -1;
+	int noDelay = 1;
+
+	while((estabSocketFD = accept4(listenSocketFD, NULL, NULL, SOCK_NONBLOCK)) >= 0){
+		struct connection *conn = calloc(1, sizeof(struct connection));
+
+		// the accept, setsockopt and epoll_ctl
+		syscallCount += 3;
+
+		if(conn == NULL){
+			close(estabSocketFD);
+			continue;
+		}
+
+		// the response header is held back with MSG_MORE and each chunk is sent whole, so
+		// Nagle has nothing to batch and would only stall a chunk behind a delayed ACK
+		setsockopt(estabSocketFD, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+
+		conn->socketFD = estabSocketFD;
+		conn->slot = -1;
+		conn->state = READING_HEADER;
+		conn->events = EPOLLIN;
+
+		memset(&event, 0, sizeof(event));
+		event.events = EPOLLIN;
+		event.data.ptr = conn;
+		if(epoll_ctl(epollFD, EPOLL_CTL_ADD, estabSocketFD, &event) < 0){
+			close(estabSocketFD);
+			free(conn);
+		}
+	}
+
+	// the accept that found nothing left
+	syscallCount++;
+
+	if(errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR){
+		fprintf(stderr, "Error: error on accept\n");
+	}
+}
+
+
+/*
+ * Function Name: serviceConnection()
+ * Description: This function moves a connection through its states for as long as it can without
+ *		blocking. Each chunk is read, run through the cipher in place and written straight back before the next
+ *		chunk is read, so a connection never holds more than one chunk of payload and key. After
+ *		the last chunk of a request the connection goes back to waiting for the next header.
+ * Preconditions: The connection must have been created by acceptConnections().
+ * Postconditions: The connection is waiting on epoll for whatever it needs next
+ * Returns: 0 if the connection should be kept, anything else if it should be closed
+*/
+int serviceConnection(int epollFD, struct connection *conn){
+	struct epoll_event event;
+	int result = 0;
+
+	while(1){
+		if(conn->state == READING_HEADER || conn->state == READING_KEY_ID || conn->state == READING_PAYLOAD || conn->state == READING_KEY){
+			result = readConnection(conn);
+			if(result < 0){
+				return -1;
+			}
+
+			// nothing more to read yet, wait for the client to send more
+			if(result == 0){
+				break;
+			}
+			continue;
+		}
+
+		if(conn->state == COMPUTING){
+			computeConnection(conn);
+		}
+
+		if(conn->state == WRITING){
+			result = writeConnection(conn);
+			if(result < 0){
+				return -1;
+			}
+
+			// the socket is full, wait until it can take the rest of the chunk
+			if(result == 0){
+				break;
+			}
+
+			// a rejected request only gets its response header before the connection is closed
+			if(conn->closeAfterWrite){
+				shutdown(conn->socketFD, SHUT_WR);
+				syscallCount++;
+				return 1;
+			}
+
+			// move on to the next chunk, or the next request once this one is finished
+			startChunk(conn);
+		}
+	}
+
+	// only tell epoll about it when the thing being waited on changes
+	memset(&event, 0, sizeof(event));
+	event.events = (conn->state == WRITING) ? EPOLLOUT : EPOLLIN;
+	event.data.ptr = conn;
+	if(event.events != conn->events){
+		epoll_ctl(epollFD, EPOLL_CTL_MOD, conn->socketFD, &event);
+		syscallCount++;
+		conn->events = event.events;
+	}
+
+	return 0;
+}
+
+
+/*
+ * Function Name: readConnection()
+ * Description: This function reads whatever part of the current header, key reference, payload chunk or
+ *		key chunk is available on a connection. The reads never ask for more than the current piece still needs,
+ *		so the bytes of a following request are left in the socket until they're wanted.
+ * Preconditions: The connection must be in one of the reading states.
+ * Postconditions: The state has moved on once the piece being read is complete
+ * Returns: 1 if bytes were read, 0 if none are available yet, -1 if the connection should be closed
+*/
+int readConnection(struct connection *conn){
+	ssize_t charsRead = -1;
+
+	if(conn->state == READING_HEADER){
+		charsRead = recv(conn->socketFD, conn->header + conn->headerLength, OTP_REQUEST_HEADER_SIZE - conn->headerLength, 0);
+	}
+	else if(conn->state == READING_KEY_ID){
+		charsRead = recv(conn->socketFD, conn->reference + conn->referenceRead, conn->referenceLength - conn->referenceRead, 0);
+	}
+	else if(conn->state == READING_PAYLOAD){
+		charsRead = recv(conn->socketFD, conn->text + conn->textLength, conn->wireLength - conn->textLength, 0);
+	}
+	else{
+		charsRead = recv(conn->socketFD, conn->key + conn->keyLength, conn->wireLength - conn->keyLength, 0);
+	}
+	syscallCount++;
+
+	if(charsRead < 0){
+		return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) ? 0 : -1;
+	}
+
+	// the client hung up, which is only expected between requests but either way we're done
+	if(charsRead == 0){
+		return -1;
+	}
+
+	if(conn->state == READING_HEADER){
+		conn->headerLength += charsRead;
+		if(conn->headerLength == OTP_REQUEST_HEADER_SIZE){
+			return startRequest(conn);
+		}
+	}
+	else if(conn->state == READING_KEY_ID){
+		conn->referenceRead += charsRead;
+		if(conn->referenceRead == conn->referenceLength){
+			return answerRequest(conn, findStoredKey(conn->reference, conn->referenceLength, conn->request.payloadLength, &conn->storedKey));
+		}
+	}
+	else if(conn->state == READING_PAYLOAD){
+		conn->textLength += charsRead;
+		if(conn->textLength == conn->wireLength){
+			conn->state = (conn->storedKey != NULL) ? COMPUTING : READING_KEY;
+		}
+	}
+	else{
+		conn->keyLength += charsRead;
+		if(conn->keyLength == conn->wireLength){
+			conn->state = COMPUTING;
+		}
+	}
+
+	return 1;
+}
+
+
+/*
+ * Function Name: startRequest()
+ * Description: This function looks at a fully received request header. A request that refers to a
+ *		stored pad goes on to read its key reference, anything else is answered right away.
+ * Preconditions: The whole request header must have been received.
+ * Postconditions: The connection is reading the key reference, the first chunk, or writing the response header
+ * Returns: 1 on success, -1 if the buffers couldn't be allocated
+*/
+int startRequest(struct connection *conn){
+	int status = -1;
+
+	unpackRequest(conn->header, &conn->request);
+	requestCount++;
+
+	conn->storedKey = NULL;
+	status = checkRequest(&conn->request);
+	if(status == OTP_STATUS_OK && (conn->request.flags & OTP_FLAG_KEY_ID)){
+		conn->referenceLength = conn->request.keyLength;
+		conn->referenceRead = 0;
+		conn->state = READING_KEY_ID;
+		return 1;
+	}
+
+	return answerRequest(conn, status);
+}
+
+
+/*
+ * Function Name: answerRequest()
+ * Description: This function prepares the response header for a request once its status is known.
+ *		An accepted request gets chunk buffers sized to its payload, up to one chunk, that are reused
+ *		by every later request on the connection that fits in them.
+ * Preconditions: The request header (and key reference, if it has one) must have been received.
+ * Postconditions: The connection is reading the first chunk, or writing the response header
+ * Returns: 1 on success, -1 if the buffers couldn't be allocated
+*/
+int answerRequest(struct connection *conn, int status){
+	struct otpResponse response;
+	size_t bufferSize = 0;
+
+	response.magic = OTP_MAGIC;
+	response.version = OTP_VERSION;
+	response.status = status;
+	response.flags = (status == OTP_STATUS_OK) ? (conn->request.flags & OTP_FLAG_PACKED) : 0;
+	response.requestId = conn->request.requestId;
+	response.length = (response.status == OTP_STATUS_OK) ? conn->request.payloadLength : 0;
+	packResponse(&response, conn->response);
+
+	conn->responseSent = 0;
+	conn->closeAfterWrite = (response.status != OTP_STATUS_OK);
+	conn->remaining = response.length;
+
+	bufferSize = (conn->remaining < CHUNK_SIZE) ? conn->remaining : CHUNK_SIZE;
+	if(sizeBuffers(conn, bufferSize) < 0){
+		return -1;
+	}
+
+	// the response header goes out with the first chunk, or on its own for an
+	// empty or rejected request
+	if(conn->remaining == 0){
+		conn->chunkLength = 0;
+		conn->wireLength = 0;
+		conn->resultSent = 0;
+		conn->state = WRITING;
+	}
+	else{
+		startChunk(conn);
+	}
+
+	return 1;
+}
+
+
+/*
+ * Function Name: sizeBuffers()
+ * Description: This function gives a connection chunk buffers that fit a request. An io_uring
+ *		connection moves back to a small registered slot whenever the request fits in one and one is
+ *		free, giving up its large slot or allocated buffers, so those are only held while long messages
+ *		are being served. Buffers too small for the request are only grown: an io_uring connection on a
+ *		small slot moves to a large one if any is free, and otherwise the text and key buffers become one
+ *		new allocation of just the size needed, which replaces the old one rather than growing it, since
+ *		nothing in the buffers has to be kept between requests. Nothing is zeroed, every byte is received
+ *		before it's read.
+ * Preconditions: The connection must have no chunk in progress. size must be at most CHUNK_SIZE.
+ * Postconditions: The connection's buffers hold at least size characters each
+ * Returns: 0 on success, -1 if there's no memory
+*/
+int sizeBuffers(struct connection *conn, size_t size){
+	char *buffers = NULL;
+
+	if(uringBuffers != NULL && (conn->slot < 0 || conn->slot >= URING_SLOTS) && size <= URING_SMALL_CHUNK && freeSlotCount > 0){
+		if(conn->slot >= URING_SLOTS){
+			freeLargeSlots[freeLargeSlotCount++] = conn->slot - URING_SLOTS;
+		}
+		else{
+			free(conn->text);
+		}
+
+		conn->slot = freeSlots[--freeSlotCount];
+		conn->text = uringBuffers->small[conn->slot].text;
+		conn->key = uringBuffers->small[conn->slot].key;
+		conn->bufferSize = URING_SMALL_CHUNK;
+		return 0;
+	}
+
+	if(size <= conn->bufferSize){
+		return 0;
+	}
+
+	if(conn->slot >= 0 && conn->slot < URING_SLOTS && freeLargeSlotCount > 0){
+		freeSlots[freeSlotCount++] = conn->slot;
+		conn->slot = URING_SLOTS + freeLargeSlots[--freeLargeSlotCount];
+		conn->text = uringBuffers->large[conn->slot - URING_SLOTS].text;
+		conn->key = uringBuffers->large[conn->slot - URING_SLOTS].key;
+		conn->bufferSize = CHUNK_SIZE;
+		return 0;
+	}
+
+	buffers = malloc(2 * size);
+	if(buffers == NULL){
+		return -1;
+	}
+
+	// a connection that outgrew its small slot gives it back to the next one accepted
+	if(conn->slot >= 0){
+		freeSlots[freeSlotCount++] = conn->slot;
+		conn->slot = -1;
+	}
+	else{
+		free(conn->text);
+	}
+
+	conn->text = buffers;
+	conn->key = buffers + size;
+	conn->bufferSize = size;
+
+	return 0;
+}
+
+
+/*
+ * Function Name: startChunk()
+ * Description: This function sets a connection up to read the next chunk of the current request,
+ *		or to read the next request's header once the current one has been fully answered.
+ * Preconditions: The previous chunk (if any) must have been completely written.
+ * Postconditions: The connection is in one of the reading states
+ * Returns: none
+*/
+void startChunk(struct connection *conn){
+	if(conn->remaining == 0){
+		conn->headerLength = 0;
+		conn->state = READING_HEADER;
+		return;
+	}
+
+	conn->chunkLength = (conn->remaining < CHUNK_SIZE) ? conn->remaining : CHUNK_SIZE;
+	conn->wireLength = (conn->request.flags & OTP_FLAG_PACKED) ? OTP_PACKED_LENGTH(conn->chunkLength) : conn->chunkLength;
+	conn->textLength = 0;
+	conn->keyLength = 0;
+	conn->state = READING_PAYLOAD;
+}
+
+
+/*
+ * Function Name: computeConnection()
+ * Description: This function runs the cipher over the chunk a connection has received. The result is written
+ *		over the payload since nothing needs the original payload after this point. A packed chunk is unpacked
+ *		in place first, and its result packed in place again.
+ * Preconditions: The payload and key of the chunk must both be fully received.
+ * Postconditions: The text buffer holds the finished chunk and the state is writing
+ * Returns: none
+*/
+void computeConnection(struct connection *conn){
+	int packed = conn->request.flags & OTP_FLAG_PACKED;
+
+	// a packed chunk is spread back out to one char per character where it landed
+	if(packed){
+		otpUnpack((unsigned char *)conn->text, conn->text, conn->chunkLength);
+		if(conn->storedKey == NULL){
+			otpUnpack((unsigned char *)conn->key, conn->key, conn->chunkLength);
+		}
+	}
+
+	// run the cipher, with the next part of the stored pad if the request refers to one
+	if(conn->storedKey != NULL){
+		service->cipher(conn->storedKey, conn->text, conn->text, conn->chunkLength);
+		conn->storedKey += conn->chunkLength;
+	}
+	else{
+		service->cipher(conn->key, conn->text, conn->text, conn->chunkLength);
+	}
+
+	if(packed){
+		otpPack(conn->text, (unsigned char *)conn->text, conn->chunkLength);
+	}
+
+	conn->remaining -= conn->chunkLength;
+	conn->resultSent = 0;
+	conn->state = WRITING;
+}
+
+
+/*
+ * Function Name: writeConnection()
+ * Description: This function sends as much of the pending response header and finished chunk as
+ *		the socket will currently accept.
+ * Preconditions: The connection must be in the writing state.
+ * Postconditions: The sent counts have been moved forward by the number of bytes sent
+ * Returns: 0 if more is left to send, 1 once everything is sent, -1 on error
+*/
+int writeConnection(struct connection *conn){
+	ssize_t charsWritten = -1;
+
+	// the response header only goes out once per request, ahead of its first chunk
+	while(conn->responseSent < OTP_RESPONSE_HEADER_SIZE){
+		charsWritten = send(conn->socketFD, conn->response + conn->responseSent, OTP_RESPONSE_HEADER_SIZE - conn->responseSent, (conn->chunkLength > 0) ? MSG_MORE : 0);
+		syscallCount++;
+
+		if(charsWritten < 0){
+			return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) ? 0 : -1;
+		}
+
+		conn->responseSent += charsWritten;
+	}
+
+	while(conn->resultSent < conn->wireLength){
+		charsWritten = send(conn->socketFD, conn->text + conn->resultSent, conn->wireLength - conn->resultSent, 0);
+		syscallCount++;
+
+		if(charsWritten < 0){
+			return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) ? 0 : -1;
+		}
+
+		conn->resultSent += charsWritten;
+	}
+
+	return 1;
+}
+
+
+/*
+ * Function Name: closeConnection()
+ * Description: This function removes a connection from epoll, closes its socket and frees it.
+ * Preconditions: The connection must have been created by acceptConnections().
+ * Postconditions: The connection no longer exists
+ * Returns: none
+*/
+void closeConnection(int epollFD, struct connection *conn){
+	epoll_ctl(epollFD, EPOLL_CTL_DEL, conn->socketFD, NULL);
+	close(conn->socketFD);
+	syscallCount += 2;
+	free(conn->text);
+	free(conn);
+}
+
+
+/*
+ * Function Name: runUringServer()
+ * Description: This is the io_uring serving loop. Like the epoll loop a single thread holds every
+ *		connection, but instead of being told which sockets are ready and then reading and writing
+ *		them one call at a time, it queues the reads and writes themselves and the kernel finishes
+ *		them in the background. One accept stays queued for every new connection, the payload and key
+ *		of a chunk are received straight into registered buffers by a linked pair of reads, and the
+ *		response header and result are sent by a linked pair of sends. Everything queued since the
+ *		last pass goes to the kernel in the same io_uring_enter() call that waits for completions.
+ * Preconditions: The listen socket must be bound and listening.
+ * Postconditions: none, the loop runs until the daemon is killed
+ * Returns: -1 if io_uring can't be used, otherwise never returns
+*/
+int runUringServer(int listenSocketFD){
+	struct uringRing ring;
+	struct iovec registered;
+	struct io_uring_cqe *cqe = NULL;
+	unsigned int head = 0;
+	uint64_t userData = 0;
+	int result = 0;
+	int cqeFlags = 0;
+	int multishot = 1;
+	int signalFD = -1;
+	int i = 0;
+
+	if(setupUring(&ring) < 0){
+		return -1;
+	}
+
+	// register every slot's buffers as one region so the kernel pins them once, up front
+	uringBuffers = aligned_alloc(4096, sizeof(struct uringBuffers));
+	if(uringBuffers == NULL){
+		close(ring.ringFD);
+		return -1;
+	}
+
+	registered.iov_base = uringBuffers;
+	registered.iov_len = sizeof(struct uringBuffers);
+	if(syscall(__NR_io_uring_register, ring.ringFD, IORING_REGISTER_BUFFERS, &registered, 1) < 0){
+		close(ring.ringFD);
+		free(uringBuffers);
+		return -1;
+	}
+
+	for(i = 0; i < URING_SLOTS; i++){
+		freeSlots[i] = URING_SLOTS - 1 - i;
+	}
+	freeSlotCount = URING_SLOTS;
+	for(i = 0; i < URING_LARGE_SLOTS; i++){
+		freeLargeSlots[i] = URING_LARGE_SLOTS - 1 - i;
+	}
+	freeLargeSlotCount = URING_LARGE_SLOTS;
+
+	signalFD = openReportSignal();
+	queueAccept(&ring, listenSocketFD, multishot);
+	queueSignal(&ring, signalFD);
+
+	while(1){
+		// hand over everything queued and wait for at least one completion
+		if(submitUring(&ring, 1) < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY){
+			perror("Error: io_uring_enter failed");
+		}
+
+		head = *ring.cqHead;
+		while(head != __atomic_load_n(ring.cqTail, __ATOMIC_ACQUIRE)){
+			// copy the completion out and give its entry back before acting on it
+			cqe = &ring.cqes[head & *ring.cqMask];
+			userData = cqe->user_data;
+			result = cqe->res;
+			cqeFlags = cqe->flags;
+			head++;
+			__atomic_store_n(ring.cqHead, head, __ATOMIC_RELEASE);
+
+			switch(userData & URING_TAG_MASK){
+				case URING_ACCEPT:
+					// a kernel without multishot accept says so on the first one, so fall back to one at a time
+					if(result == -EINVAL && multishot){
+						multishot = 0;
+					}
+					else if(result >= 0){
+						startUringConnection(&ring, result);
+					}
+					else if(result != -EINTR && result != -EAGAIN && result != -ECONNABORTED){
+						fprintf(stderr, "Error: error on accept\n");
+					}
+
+					if(!(cqeFlags & IORING_CQE_F_MORE)){
+						queueAccept(&ring, listenSocketFD, multishot);
+					}
+					break;
+
+				case URING_SIGNAL:
+					if(result == sizeof(uringSignal)){
+						reportSyscalls();
+					}
+					queueSignal(&ring, signalFD);
+					break;
+
+				case URING_CLOSE:
+					break;
+
+				default:
+					completeUringConnection(&ring, (struct connection *)(uintptr_t)(userData & ~(uint64_t)URING_TAG_MASK),
+						userData & URING_TAG_MASK, result);
+			}
+		}
+	}
+
+	return 0;
+}
+
+
+/*
+ * Function Name: setupUring()
+ * Description: This function creates an io_uring instance with the raw system calls and maps its
+ *		submission and completion rings. It also checks that the kernel supports every operation
+ *		the loop uses, so an old kernel is caught here rather than part way through serving.
+ * Preconditions: none
+ * Postconditions: The ring is ready to queue entries on
+ * Returns: 0 on success, -1 if io_uring can't be used
+*/
+int setupUring(struct uringRing *ring){
+	static const int neededOps[] = { IORING_OP_ACCEPT, IORING_OP_RECV, IORING_OP_SEND, IORING_OP_READ_FIXED,
+		IORING_OP_WRITE_FIXED, IORING_OP_READ, IORING_OP_CLOSE };
+	struct io_uring_params params;
+	struct io_uring_probe *probe = NULL;
+	size_t ringSize = 0;
+	size_t i = 0;
+	char *rings = NULL;
+
+	// only this thread submits, so the kernel can leave completion work until it next waits
+	// in io_uring_enter() instead of interrupting the loop for it, if it's new enough to know how
+	memset(&params, 0, sizeof(params));
+	params.flags = IORING_SETUP_CQSIZE | IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_DEFER_TASKRUN;
+	params.cq_entries = URING_CQ_ENTRIES;
+
+	ring->ringFD = syscall(__NR_io_uring_setup, URING_ENTRIES, &params);
+	if(ring->ringFD < 0 && errno == EINVAL){
+		memset(&params, 0, sizeof(params));
+		params.flags = IORING_SETUP_CQSIZE;
+		params.cq_entries = URING_CQ_ENTRIES;
+		ring->ringFD = syscall(__NR_io_uring_setup, URING_ENTRIES, &params);
+	}
+
+	if(ring->ringFD < 0){
+		return -1;
+	}
+
+	// kernels old enough to need the rings mapped separately are too old for the rest as well
+	if(!(params.features & IORING_FEAT_SINGLE_MMAP)){
+		close(ring->ringFD);
+		return -1;
+	}
+
+	probe = calloc(1, sizeof(struct io_uring_probe) + 256 * sizeof(struct io_uring_probe_op));
+	if(probe == NULL || syscall(__NR_io_uring_register, ring->ringFD, IORING_REGISTER_PROBE, probe, 256) < 0){
+		free(probe);
+		close(ring->ringFD);
+		return -1;
+	}
+
+	for(i = 0; i < sizeof(neededOps) / sizeof(neededOps[0]); i++){
+		if(neededOps[i] > probe->last_op || !(probe->ops[neededOps[i]].flags & IO_URING_OP_SUPPORTED)){
+			free(probe);
+			close(ring->ringFD);
+			return -1;
+		}
+	}
+	free(probe);
+
+	// the submission and completion rings share one mapping, the entries themselves have their own
+	ringSize = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+	if(params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe) > ringSize){
+		ringSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+	}
+
+	rings = mmap(NULL, ringSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->ringFD, IORING_OFF_SQ_RING);
+	ring->sqes = mmap(NULL, params.sq_entries * sizeof(struct io_uring_sqe), PROT_READ | PROT_WRITE,
+		MAP_SHARED | MAP_POPULATE, ring->ringFD, IORING_OFF_SQES);
+	if(rings == MAP_FAILED || ring->sqes == MAP_FAILED){
+		close(ring->ringFD);
+		return -1;
+	}
+
+	ring->entries = params.sq_entries;
+	ring->sqHead = (unsigned int *)(rings + params.sq_off.head);
+	ring->sqTail = (unsigned int *)(rings + params.sq_off.tail);
+	ring->sqMask = (unsigned int *)(rings + params.sq_off.ring_mask);
+	ring->sqArray = (unsigned int *)(rings + params.sq_off.array);
+	ring->sqLocalTail = *ring->sqTail;
+	ring->sqSubmitted = ring->sqLocalTail;
+	ring->cqHead = (unsigned int *)(rings + params.cq_off.head);
+	ring->cqTail = (unsigned int *)(rings + params.cq_off.tail);
+	ring->cqMask = (unsigned int *)(rings + params.cq_off.ring_mask);
+	ring->cqes = (struct io_uring_cqe *)(rings + params.cq_off.cqes);
+
+	return 0;
+}
+
+
+/*
+ * Function Name: getSqe()
+ * Description: This function takes the next free submission entry and clears it. Nothing is shown
+ *		to the kernel until submitUring() is called, unless the ring is full, in which case
+ *		everything queued so far is submitted first to make room.
+ * Preconditions: The ring must have been set up by setupUring().
+ * Postconditions: The entry will be submitted by the next submitUring()
+ * Returns: the entry to fill in
+*/
+struct io_uring_sqe *getSqe(struct uringRing *ring){
+	struct io_uring_sqe *sqe = NULL;
+	unsigned int index = 0;
+
+	while(ring->sqLocalTail - __atomic_load_n(ring->sqHead, __ATOMIC_ACQUIRE) >= ring->entries){
+		submitUring(ring, 0);
+	}
+
+	index = ring->sqLocalTail & *ring->sqMask;
+	sqe = &ring->sqes[index];
+	memset(sqe, 0, sizeof(struct io_uring_sqe));
+	ring->sqArray[index] = index;
+	ring->sqLocalTail++;
+
+	return sqe;
+}
+
+
+/*
+ * Function Name: submitUring()
+ * Description: This function publishes every queued submission entry to the kernel and, if asked,
+ *		waits in the same system call for completions to arrive.
+ * Preconditions: The ring must have been set up by setupUring().
+ * Postconditions: The queued entries have been submitted
+ * Returns: the number of entries submitted, or -1 with errno set
+*/
+int submitUring(struct uringRing *ring, unsigned int waitCount){
+	unsigned int toSubmit = ring->sqLocalTail - ring->sqSubmitted;
+	int result = -1;
+
+	__atomic_store_n(ring->sqTail, ring->sqLocalTail, __ATOMIC_RELEASE);
+
+	result = syscall(__NR_io_uring_enter, ring->ringFD, toSubmit, waitCount, (waitCount > 0) ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+	syscallCount++;
+
+	if(result > 0){
+		ring->sqSubmitted += result;
+	}
+
+	return result;
+}
+
+
+/*
+ * Function Name: queueAccept()
+ * Description: This function queues an accept on the listen socket. A multishot accept keeps
+ *		producing a completion for every new connection until the kernel says it has stopped.
+ * Preconditions: The ring must have been set up by setupUring().
+ * Postconditions: The accept is queued
+ * Returns: none
+*/
+void queueAccept(struct uringRing *ring, int listenSocketFD, int multishot){
+	struct io_uring_sqe *sqe = getSqe(ring);
+
+	sqe->opcode = IORING_OP_ACCEPT;
+	sqe->fd = listenSocketFD;
+	sqe->ioprio = multishot ? IORING_ACCEPT_MULTISHOT : 0;
+	sqe->user_data = URING_ACCEPT;
+}
+
+
+/*
+ * Function Name: queueSignal()
+ * Description: This function queues a read of the SIGUSR1 signalfd, so a request for the counts
+ *		arrives as a completion like everything else.
+ * Preconditions: The ring must have been set up by setupUring().
+ * Postconditions: The read is queued
+ * Returns: none
+*/
+void queueSignal(struct uringRing *ring, int signalFD){
+	struct io_uring_sqe *sqe = getSqe(ring);
+
+	sqe->opcode = IORING_OP_READ;
+	sqe->fd = signalFD;
+	sqe->addr = (uintptr_t)&uringSignal;
+	sqe->len = sizeof(uringSignal);
+	sqe->user_data = URING_SIGNAL;
+}
+
+
+/*
+ * Function Name: startUringConnection()
+ * Description: This function sets up a newly accepted connection with one of the small registered
+ *		buffer slots and queues the read of its first request header. When every slot is taken the
+ *		connection's buffers are allocated by sizeBuffers() instead, once it's sent a request.
+ * Preconditions: The socket must have just been accepted.
+ * Postconditions: The connection is reading its first header, or is closed
+ * Returns: none
+*/
+void startUringConnection(struct uringRing *ring, int estabSocketFD){
+	struct connection *conn = NULL;
+	int noDelay = 1;
+
+	if((conn = calloc(1, sizeof(struct connection))) == NULL){
+		close(estabSocketFD);
+		syscallCount++;
+		return;
+	}
+
+	// the response header is sent with MSG_MORE, so Nagle would only stall the chunk behind it
+	setsockopt(estabSocketFD, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+	syscallCount++;
+
+	conn->socketFD = estabSocketFD;
+	conn->slot = -1;
+	conn->state = READING_HEADER;
+	if(freeSlotCount > 0){
+		conn->slot = freeSlots[--freeSlotCount];
+		conn->text = uringBuffers->small[conn->slot].text;
+		conn->key = uringBuffers->small[conn->slot].key;
+		conn->bufferSize = URING_SMALL_CHUNK;
+	}
+
+	queueConnection(ring, conn);
+}
+
+
+/*
+ * Function Name: queueConnection()
+ * Description: This function queues whatever a connection needs next. The header and key reference
+ *		are received on their own, the rest of a chunk's payload is linked to the rest of its key so the key read only
+ *		starts once the payload is in, and the response header is linked to the result so they go out
+ *		in order. A finished chunk is computed here, and a finished send moves on to the next chunk
+ *		or request.
+ * Preconditions: The connection must have nothing in flight.
+ * Postconditions: The connection has operations in flight, or is closed
+ * Returns: none
+*/
+void queueConnection(struct uringRing *ring, struct connection *conn){
+	struct io_uring_sqe *sqe = NULL;
+
+	// get past the steps that don't need the kernel
+	while(1){
+		if(conn->state == COMPUTING){
+			computeConnection(conn);
+		}
+
+		if(conn->state == WRITING && conn->responseSent == OTP_RESPONSE_HEADER_SIZE && conn->resultSent == conn->wireLength){
+			// a rejected request only gets its response header before the connection is closed
+			if(conn->closeAfterWrite){
+				shutdown(conn->socketFD, SHUT_WR);
+				syscallCount++;
+				closeUringConnection(ring, conn);
+				return;
+			}
+
+			startChunk(conn);
+			continue;
+		}
+
+		break;
+	}
+
+	if(conn->state == READING_HEADER){
+		sqe = getSqe(ring);
+		sqe->opcode = IORING_OP_RECV;
+		sqe->fd = conn->socketFD;
+		sqe->addr = (uintptr_t)(conn->header + conn->headerLength);
+		sqe->len = OTP_REQUEST_HEADER_SIZE - conn->headerLength;
+		sqe->user_data = (uintptr_t)conn | URING_HEADER;
+		conn->pending++;
+	}
+
+	// the key reference is read under the header's tag, the state says which it is
+	if(conn->state == READING_KEY_ID){
+		sqe = getSqe(ring);
+		sqe->opcode = IORING_OP_RECV;
+		sqe->fd = conn->socketFD;
+		sqe->addr = (uintptr_t)(conn->reference + conn->referenceRead);
+		sqe->len = conn->referenceLength - conn->referenceRead;
+		sqe->user_data = (uintptr_t)conn | URING_HEADER;
+		conn->pending++;
+	}
+
+	// a request using a stored pad has no key chunks to read. Allocated buffers aren't registered, so
+	// they're received into with MSG_WAITALL, which fails the link on a short read like a fixed read does
+	if(conn->state == READING_PAYLOAD){
+		sqe = getSqe(ring);
+		sqe->opcode = (conn->slot >= 0) ? IORING_OP_READ_FIXED : IORING_OP_RECV;
+		sqe->flags = (conn->storedKey == NULL) ? IOSQE_IO_LINK : 0;
+		sqe->fd = conn->socketFD;
+		sqe->addr = (uintptr_t)(conn->text + conn->textLength);
+		sqe->len = conn->wireLength - conn->textLength;
+		if(conn->slot < 0){
+			sqe->msg_flags = MSG_WAITALL;
+		}
+		sqe->user_data = (uintptr_t)conn | URING_PAYLOAD;
+		conn->pending++;
+	}
+
+	if((conn->state == READING_PAYLOAD && conn->storedKey == NULL) || conn->state == READING_KEY){
+		sqe = getSqe(ring);
+		sqe->opcode = (conn->slot >= 0) ? IORING_OP_READ_FIXED : IORING_OP_RECV;
+		sqe->fd = conn->socketFD;
+		sqe->addr = (uintptr_t)(conn->key + conn->keyLength);
+		sqe->len = conn->wireLength - conn->keyLength;
+		if(conn->slot < 0){
+			sqe->msg_flags = MSG_WAITALL;
+		}
+		sqe->user_data = (uintptr_t)conn | URING_KEY;
+		conn->pending++;
+	}
+
+	if(conn->state == WRITING && conn->responseSent < OTP_RESPONSE_HEADER_SIZE){
+		// MSG_WAITALL makes a short send fail the link rather than let the result overtake the header
+		sqe = getSqe(ring);
+		sqe->opcode = IORING_OP_SEND;
+		sqe->flags = (conn->resultSent < conn->wireLength) ? IOSQE_IO_LINK : 0;
+		sqe->fd = conn->socketFD;
+		sqe->addr = (uintptr_t)(conn->response + conn->responseSent);
+		sqe->len = OTP_RESPONSE_HEADER_SIZE - conn->responseSent;
+		sqe->msg_flags = MSG_WAITALL | ((conn->chunkLength > 0) ? MSG_MORE : 0);
+		sqe->user_data = (uintptr_t)conn | URING_RESPONSE;
+		conn->pending++;
+	}
+
+	if(conn->state == WRITING && conn->resultSent < conn->wireLength){
+		sqe = getSqe(ring);
+		sqe->opcode = (conn->slot >= 0) ? IORING_OP_WRITE_FIXED : IORING_OP_SEND;
+		sqe->fd = conn->socketFD;
+		sqe->addr = (uintptr_t)(conn->text + conn->resultSent);
+		sqe->len = conn->wireLength - conn->resultSent;
+		if(conn->slot < 0){
+			sqe->msg_flags = MSG_WAITALL;
+		}
+		sqe->user_data = (uintptr_t)conn | URING_RESULT;
+		conn->pending++;
+	}
+}
+
+
+/*
+ * Function Name: completeUringConnection()
+ * Description: This function records one finished operation on a connection. A short read or write
+ *		cancels whatever was linked after it, so nothing else is queued until every operation in
+ *		flight has come back, and then queueConnection() picks up from wherever the counts say the
+ *		connection got to.
+ * Preconditions: The completion must belong to an operation queued by queueConnection().
+ * Postconditions: The connection's counts and state have been moved forward
+ * Returns: none
+*/
+void completeUringConnection(struct uringRing *ring, struct connection *conn, int tag, int result){
+	conn->pending--;
+
+	// a result of 0 means the client hung up, and a cancelled operation is just queued again later
+	if(result <= 0){
+		if(result != -ECANCELED){
+			conn->failed = 1;
+		}
+	}
+	else if(tag == URING_HEADER && conn->state == READING_HEADER){
+		conn->headerLength += result;
+		if(conn->headerLength == OTP_REQUEST_HEADER_SIZE && startRequest(conn) < 0){
+			conn->failed = 1;
+		}
+	}
+	else if(tag == URING_HEADER){
+		conn->referenceRead += result;
+		if(conn->referenceRead == conn->referenceLength &&
+		   answerRequest(conn, findStoredKey(conn->reference, conn->referenceLength, conn->request.payloadLength, &conn->storedKey)) < 0){
+			conn->failed = 1;
+		}
+	}
+	else if(tag == URING_PAYLOAD){
+		conn->textLength += result;
+		if(conn->textLength == conn->wireLength){
+			conn->state = (conn->storedKey != NULL) ? COMPUTING : READING_KEY;
+		}
+	}
+	else if(tag == URING_KEY){
+		conn->keyLength += result;
+		if(conn->keyLength == conn->wireLength){
+			conn->state = COMPUTING;
+		}
+	}
+	else if(tag == URING_RESPONSE){
+		conn->responseSent += result;
+	}
+	else{
+		conn->resultSent += result;
+	}
+
+	if(conn->pending > 0){
+		return;
+	}
+
+	if(conn->failed){
+		closeUringConnection(ring, conn);
+	}
+	else{
+		queueConnection(ring, conn);
+	}
+}
+
+
+/*
+ * Function Name: closeUringConnection()
+ * Description: This function queues the close of a connection's socket, gives its buffer slot back
+ *		(or frees its buffers) and frees it.
+ * Preconditions: The connection must have nothing in flight.
+ * Postconditions: The connection no longer exists
+ * Returns: none
+*/
+void closeUringConnection(struct uringRing *ring, struct connection *conn){
+	struct io_uring_sqe *sqe = getSqe(ring);
+
+	sqe->opcode = IORING_OP_CLOSE;
+	sqe->fd = conn->socketFD;
+	sqe->user_data = URING_CLOSE;
+
+	if(conn->slot >= URING_SLOTS){
+		freeLargeSlots[freeLargeSlotCount++] = conn->slot - URING_SLOTS;
+	}
+	else if(conn->slot >= 0){
+		freeSlots[freeSlotCount++] = conn->slot;
+	}
+	else{
+		free(conn->text);
+	}
+	free(conn);
+}
+
+
+/*
+ * Function Name: handleConnection()
+ * Description: This function serves a single client connection in the forked modes. Requests are
+ *		answered one after another until the client hangs up. The body of each request arrives as
+ *		chunks of payload, each followed by the matching chunk of key, unless the request refers to a
+ *		stored pad, in which case the reference comes first and only the payload chunks follow. Every chunk is run through the
+ *		cipher and sent back as soon as it is in, so only one chunk is ever held in memory and there is no
+ *		limit on the length of a message. The chunk buffers belong to the caller and are reused as they
+ *		are, since every byte of them is overwritten before it is read.
+ * Preconditions: A client connection must have been accepted on the socket passed in.
+ * Postconditions: Every request has been answered and the connection is closed
+ * Returns: none
+*/
+void handleConnection(int estabSocketFD, struct workerBuffers *buffers){
+	// char arrays that will hold one chunk of the payload and key at a time
+	char *text = buffers->text;
+	char *key = buffers->key;
+	unsigned char header[OTP_REQUEST_HEADER_SIZE];
+	unsigned char reference[OTP_KEY_REFERENCE_MAX];
+	const char *storedKey = NULL;
+	struct otpRequest request;
+	struct otpResponse response;
+	uint64_t remaining = 0;
+	size_t chunkLength = 0;
+	size_t wireLength = 0;
+	int connectionOpen = 1;
+	int noDelay = 1;
+
+	// the response header is held back with MSG_MORE and each chunk is sent whole, so
+	// Nagle has nothing to batch and would only stall a chunk behind a delayed ACK
+	setsockopt(estabSocketFD, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+
+	// keep answering requests until the client hangs up
+	while(connectionOpen && recvAll(estabSocketFD, header, sizeof(header)) == sizeof(header)){
+		unpackRequest(header, &request);
+
+		response.magic = OTP_MAGIC;
+		response.version = OTP_VERSION;
+		response.status = checkRequest(&request);
+		response.flags = request.flags & OTP_FLAG_PACKED;
+
+		// a request using a stored pad sends a reference to it in place of the key
+		storedKey = NULL;
+		if(response.status == OTP_STATUS_OK && (request.flags & OTP_FLAG_KEY_ID)){
+			if(recvAll(estabSocketFD, reference, request.keyLength) != (ssize_t)request.keyLength){
+				break;
+			}
+			response.status = findStoredKey(reference, request.keyLength, request.payloadLength, &storedKey);
+		}
+
+		response.requestId = request.requestId;
+		response.length = (response.status == OTP_STATUS_OK) ? request.payloadLength : 0;
+		if(response.status != OTP_STATUS_OK){
+			response.flags = 0;
+		}
+		packResponse(&response, header);
+
+		// hold the header back until the first chunk is ready so both go out together
+		if(sendAll(estabSocketFD, header, OTP_RESPONSE_HEADER_SIZE, (response.length > 0) ? MSG_MORE : 0) < 0 ||
+		   response.status != OTP_STATUS_OK){
+			break;
+		}
+
+		for(remaining = response.length; remaining > 0 && connectionOpen; remaining -= chunkLength){
+			chunkLength = (remaining < CHUNK_SIZE) ? remaining : CHUNK_SIZE;
+			wireLength = response.flags ? OTP_PACKED_LENGTH(chunkLength) : chunkLength;
+
+			if(recvAll(estabSocketFD, text, wireLength) != (ssize_t)wireLength ||
+			   (storedKey == NULL && recvAll(estabSocketFD, key, wireLength) != (ssize_t)wireLength)){
+				connectionOpen = 0;
+				break;
+			}
+
+			// a packed chunk is unpacked where it landed
+			if(response.flags){
+				otpUnpack((unsigned char *)text, text, chunkLength);
+				if(storedKey == NULL){
+					otpUnpack((unsigned char *)key, key, chunkLength);
+				}
+			}
+
+			// run the cipher
+			// return the finished chunk back to the client
+			if(storedKey != NULL){
+				service->cipher(storedKey, text, text, chunkLength);
+				storedKey += chunkLength;
+			}
+			else{
+				service->cipher(key, text, text, chunkLength);
+			}
+			if(response.flags){
+				otpPack(text, (unsigned char *)text, chunkLength);
+			}
+			if(sendAll(estabSocketFD, text, wireLength, 0) < 0){
+				connectionOpen = 0;
+			}
+		}
+	}
+
+	// call shutdown so the client's recv() loop will exit and not run forever
+	// credit: https://stackoverflow.com/questions/34751399/non-terminating-while-loop-while-using-recv
+	shutdown(estabSocketFD, SHUT_WR);
+
+	// close the socket for good cleanup
+	close(estabSocketFD);
+}
+
+
+/*
+ * Function Name: checkRequest()
+ * Description: This function decides whether this daemon can answer a request. Only requests
+ *		for this daemon's own operation are accepted, so otp_dec can't use otp_enc_d by mistake
+ *		(or the reverse).
+ * Preconditions: The request header must have been unpacked.
+ * Postconditions: none
+ * Returns: the status to answer the request with
+*/
+int checkRequest(const struct otpRequest *request){
+	if(request->magic != OTP_MAGIC || request->version != OTP_VERSION){
+		return OTP_STATUS_BAD_VERSION;
+	}
+
+	if(request->operation != service->operation){
+		return OTP_STATUS_WRONG_OPERATION;
+	}
+
+	// a key reference has to hold an offset and an id of sensible length
+	if(request->flags & OTP_FLAG_KEY_ID){
+		return (request->keyLength > 8 && request->keyLength <= OTP_KEY_REFERENCE_MAX) ? OTP_STATUS_OK : OTP_STATUS_BAD_REQUEST;
+	}
+
+	// every payload character needs exactly one key character
+	if(request->keyLength != request->payloadLength){
+		return OTP_STATUS_BAD_REQUEST;
+	}
+
+	return OTP_STATUS_OK;
+}
+
+/*
+ * Function Name: loadKeyDirectory()
+ * Description: This function maps every pad in the key directory into memory, read only, and sorts them
+ *		by id so a request's reference can be looked up with a binary search. A pad's id is its file
+ *		name, and it ends at its first newline like any key. Pads with characters a key can't have are
+ *		left out with a warning, so they're never found. Hidden files are skipped.
+ * Preconditions: none
+ * Postconditions: storedPads holds every usable pad, or the daemon has exited with an error
+ * Returns: none
+*/
+void loadKeyDirectory(const char *directoryName){
+	DIR *directory = opendir(directoryName);
+	struct dirent *entry = NULL;
+	struct stat fileInfo;
+	struct storedPad *newPads = NULL;
+	char path[4096];
+	const char *newline = NULL;
+	void *map = NULL;
+	int capacity = 0;
+	int fileFD = -1;
+
+	if(directory == NULL){
+		fprintf(stderr, "Error: could not open key directory '%s'\n", directoryName);
+		exit(1);
+	}
+
+	while((entry = readdir(directory)) != NULL){
+		if(entry->d_name[0] == '.' || strlen(entry->d_name) > OTP_KEY_ID_MAX){
+			continue;
+		}
+
+		snprintf(path, sizeof(path), "%s/%s", directoryName, entry->d_name);
+		fileFD = open(path, O_RDONLY);
+		if(fileFD < 0){
+			continue;
+		}
+
+		if(fstat(fileFD, &fileInfo) < 0 || !S_ISREG(fileInfo.st_mode) || fileInfo.st_size == 0){
+			close(fileFD);
+			continue;
+		}
+
+		map = mmap(NULL, fileInfo.st_size, PROT_READ, MAP_SHARED, fileFD, 0);
+		close(fileFD);
+		if(map == MAP_FAILED){
+			fprintf(stderr, "%s: could not map pad '%s'\n", service->name, path);
+			continue;
+		}
+
+		if(storedPadCount == capacity){
+			capacity = (capacity == 0) ? 16 : 2 * capacity;
+			newPads = realloc(storedPads, capacity * sizeof(struct storedPad));
+			if(newPads == NULL){
+				fprintf(stderr, "Error: out of memory\n");
+				exit(1);
+			}
+			storedPads = newPads;
+		}
+
+		newline = memchr(map, '\n', fileInfo.st_size);
+		storedPads[storedPadCount].id = strdup(entry->d_name);
+		storedPads[storedPadCount].pad = map;
+		storedPads[storedPadCount].length = (newline == NULL) ? (size_t)fileInfo.st_size : (size_t)(newline - (const char *)map);
+
+		if(otpValidate(map, storedPads[storedPadCount].length) < 0){
+			fprintf(stderr, "%s: pad '%s' contains bad characters, skipping it\n", service->name, path);
+			munmap(map, fileInfo.st_size);
+			free(storedPads[storedPadCount].id);
+			continue;
+		}
+
+		storedPadCount++;
+	}
+
+	closedir(directory);
+	qsort(storedPads, storedPadCount, sizeof(struct storedPad), comparePads);
+}
+
+
+/*
+ * Function Name: comparePads()
+ * Description: This function orders two stored pads by id, for qsort() and bsearch().
+ * Preconditions: Both arguments must point at stored pads.
+ * Postconditions: none
+ * Returns: less than, equal to or greater than 0, like strcmp()
+*/
+int comparePads(const void *a, const void *b){
+	return strcmp(((const struct storedPad *)a)->id, ((const struct storedPad *)b)->id);
+}
+
+
+/*
+ * Function Name: findStoredKey()
+ * Description: This function looks up the pad a key reference names and finds where the request's key
+ *		starts in it. The whole key, from the offset for as long as the payload, has to be inside the pad.
+ * Preconditions: The reference must be longer than 8 bytes and no longer than OTP_KEY_REFERENCE_MAX.
+ * Postconditions: key points at the first key character if the pad was found
+ * Returns: OTP_STATUS_OK, or OTP_STATUS_NO_KEY if the pad isn't held or is too short
+*/
+int findStoredKey(const unsigned char reference[], size_t referenceLength, uint64_t payloadLength, const char **key){
+	char id[OTP_KEY_ID_MAX + 1];
+	uint64_t offset = unpackNumber(reference, 8);
+	struct storedPad wanted;
+	struct storedPad *found = NULL;
+
+	// an id with a NUL in it would otherwise match the pad named by whatever comes before the NUL
+	if(memchr(reference + 8, '\0', referenceLength - 8) != NULL){
+		return OTP_STATUS_NO_KEY;
+	}
+
+	memcpy(id, reference + 8, referenceLength - 8);
+	id[referenceLength - 8] = '\0';
+	wanted.id = id;
+
+	found = (storedPadCount > 0) ? bsearch(&wanted, storedPads, storedPadCount, sizeof(struct storedPad), comparePads) : NULL;
+	if(found == NULL || offset > found->length || payloadLength > found->length - offset){
+		return OTP_STATUS_NO_KEY;
+	}
+
+	*key = found->pad + offset;
+	return OTP_STATUS_OK;
+}
+
+
+/*
+ * Function Name: checkTerminatedProcesses()
+ * Description: This function reaps every child process that has terminated. It is called when
+ *		the signalfd reports a SIGCHLD. Several children ending together may only raise one signal,
+ *		so waitpid() is called until no more finished children are found.
+ *	Preconditions: The signalfd must have been created for SIGCHLD in non-blocking mode.
+ *	Postconditions: The pending signals have been read and every finished child has been waited for.
+ *		All of this is silent and nothing will be printed to screen.
+ *	Returns: none
+*/
+void checkTerminatedProcesses(int signalFD){
+	struct signalfd_siginfo signalInfo;
+	int exitMethod = -5;
+
+	// empty the signalfd so it only becomes readable again for new signals
+	while(read(signalFD, &signalInfo, sizeof(signalInfo)) == sizeof(signalInfo)){
+	}
+
+	// continue to wait for terminating processes as long as they are found
+	while(waitpid(-1, &exitMethod, WNOHANG) > 0){
+	}
+}
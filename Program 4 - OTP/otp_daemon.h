@@ -0,0 +1,22 @@
+/*
+ * Author: John Olgin
+ * Program Name: otp_daemon.h
+ * Date: 10/18/26
+ * Description: This is the interface to the serving code shared by the otp_enc_d and otp_dec_d daemons.
+*/
+
+#ifndef OTP_DAEMON_H
+#define OTP_DAEMON_H
+
+#include "otp_cipher.h"
+
+// what makes one daemon different from the other
+struct otpService {
+	const char *name;	// the daemon's name, for messages
+	int operation;		// the only request operation the daemon answers (OTP_OP_ENCRYPT or OTP_OP_DECRYPT)
+	otpKernel cipher;	// the libotp kernel that does the work
+};
+
+int runDaemon(const struct otpService *daemonService, int argc, char *argv[]);
+
+#endif
@@ -0,0 +1,403 @@
+/*
+ * Author: John Olgin
+ * Program Name: otp_ledger.c
+ * Date: 10/18/26
+ * Description: This program hands out pieces of one large pad made by keygen, so every message can be
+ *	encrypted with its own part of the pad without making a new key file for it. Each piece is given
+ *	out once only. The pieces handed out so far are recorded in a journal kept next to the pad, and the
+ *	journal is locked while a piece is taken, so any number of clients can draw from the same pad at
+ *	once without ever getting overlapping pieces.
+ *		otp_ledger pad length|textfile ...
+ *		otp_ledger -l pad
+ *	For every length (or text file, which asks for as many characters as the text has) the first form
+ *	prints a key reference "@id:offset" that otp_enc and otp_dec accept in place of a key, when their
+ *	daemon was started with -k on the pad's directory. The second form lists the pieces handed out.
+ *
+ *	The journal for pad "dir/id" is "dir/.id.journal". It starts with a 16 byte header, then one 16 byte
+ *	record per piece:
+ *		header: magic (4 bytes), version (1), unused (3), pad length (8)
+ *		record: offset (8 bytes), length (8)
+ *	Pieces are handed out from the start of the pad in order, so the next free offset is the end of
+ *	the last record. A record is flushed to disk before its reference is printed, so a crash can never
+ *	cause a piece to be handed out twice.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "otp_cipher.h"
+#include "otp_protocol.h"
+
+#define JOURNAL_MAGIC 0x4f54504a
+#define JOURNAL_VERSION 1
+#define JOURNAL_HEADER_SIZE 16
+#define JOURNAL_RECORD_SIZE 16
+
+// the most pieces that can be asked for at once
+#define MAX_PIECES 1024
+
+int openJournal(const char *padName, const char *padId, int lockType, uint64_t *padLength, uint64_t *recordCount);
+uint64_t measurePad(const char *padName);
+uint64_t readRecord(int journalFD, uint64_t index, uint64_t *length);
+uint64_t parseLength(const char *argument);
+void listPieces(const char *padName, const char *padId);
+void lockJournal(int journalFD, int lockType);
+
+
+
+int main(int argc, char *argv[]){
+
+	// prepare variables to be used in the program
+	// give them all bogus values so I know if they aren't being changed properly
+	int journalFD = -1;
+	int pieceCount = -1;
+	int list = 0;
+	int option = -1;
+	int i = 0;
+	const char *padName = NULL;
+	const char *padId = NULL;
+	uint64_t padLength = 0;
+	uint64_t recordCount = 0;
+	uint64_t lastLength = 0;
+	uint64_t nextOffset = 0;
+	uint64_t wanted = 0;
+	static uint64_t lengths[MAX_PIECES];
+	static unsigned char records[MAX_PIECES * JOURNAL_RECORD_SIZE];
+
+	while((option = getopt(argc, argv, "l")) != -1){
+		switch(option){
+			case 'l':
+				list = 1;
+				break;
+
+			default:
+				fprintf(stderr, "Usage: otp_ledger pad length|textfile ...\n       otp_ledger -l pad\n");
+				exit(1);
+		}
+	}
+
+	// ensure the correct arguments were provided
+	if(optind >= argc || (list && argc - optind != 1) || (!list && argc - optind < 2)){
+		fprintf(stderr, "Usage: otp_ledger pad length|textfile ...\n       otp_ledger -l pad\n");
+		exit(1);
+	}
+
+	padName = argv[optind];
+	padId = (strrchr(padName, '/') != NULL) ? strrchr(padName, '/') + 1 : padName;
+	if(*padId == '\0' || strlen(padId) > OTP_KEY_ID_MAX){
+		fprintf(stderr, "Error: '%s' can't be used as a pad id\n", padName);
+		exit(1);
+	}
+
+	if(list){
+		listPieces(padName, padId);
+		return 0;
+	}
+
+	pieceCount = argc - optind - 1;
+	if(pieceCount > MAX_PIECES){
+		fprintf(stderr, "Error: at most %d pieces can be asked for at once\n", MAX_PIECES);
+		exit(1);
+	}
+
+	// measure everything before taking the lock, so it is held as briefly as possible. A total too big
+	// to count can't fit in any pad, and must not wrap around to a small one that would.
+	for(i = 0; i < pieceCount; i++){
+		lengths[i] = parseLength(argv[optind + 1 + i]);
+		if(lengths[i] > UINT64_MAX - wanted){
+			fprintf(stderr, "Error: the pieces are too long for any pad\n");
+			exit(1);
+		}
+		wanted += lengths[i];
+	}
+
+	// with the journal locked, nobody else can read the next free offset until these pieces are
+	// recorded, so no two clients can be handed the same part of the pad
+	journalFD = openJournal(padName, padId, F_WRLCK, &padLength, &recordCount);
+
+	if(recordCount > 0){
+		nextOffset = readRecord(journalFD, recordCount - 1, &lastLength) + lastLength;
+	}
+
+	for(i = 0; i < pieceCount; i++){
+		if(lengths[i] > padLength){
+			fprintf(stderr, "Error: a piece of %llu characters is longer than pad '%s'\n", (unsigned long long)lengths[i], padName);
+			exit(1);
+		}
+	}
+
+	if(nextOffset > padLength || wanted > padLength - nextOffset){
+		fprintf(stderr, "Error: pad '%s' has only %llu characters left\n", padName, (unsigned long long)(padLength - nextOffset));
+		exit(1);
+	}
+
+	for(i = 0; i < pieceCount; i++){
+		packNumber(records + i * JOURNAL_RECORD_SIZE, nextOffset, 8);
+		packNumber(records + i * JOURNAL_RECORD_SIZE + 8, lengths[i], 8);
+		nextOffset += lengths[i];
+	}
+
+	// the records go after the last whole one, over anything a crash left half written
+	if(pwrite(journalFD, records, pieceCount * JOURNAL_RECORD_SIZE, JOURNAL_HEADER_SIZE + recordCount * JOURNAL_RECORD_SIZE) != pieceCount * JOURNAL_RECORD_SIZE || fdatasync(journalFD) < 0){
+		fprintf(stderr, "Error: could not write the journal for '%s'\n", padName);
+		exit(1);
+	}
+
+	close(journalFD);
+
+
+
+
+	// only now that the pieces are safely recorded is it alright to hand them out
+	for(i = 0; i < pieceCount; i++){
+		fprintf(stdout, "@%s:%llu\n", padId, (unsigned long long)unpackNumber(records + i * JOURNAL_RECORD_SIZE, 8));
+	}
+
+	return 0;
+}
+
+
+
+
+/*
+ * Function Name: openJournal()
+ * Description: This function opens and locks the pad's journal, creating it if this is the first time
+ *		the pad has been drawn from. A new journal records the pad's length so the pad doesn't have to
+ *		be read again.
+ * Preconditions: lockType must be F_RDLCK or F_WRLCK.
+ * Postconditions: The journal is open and locked, or the program has exited with an error
+ * Returns: the journal's file descriptor, with the pad's length and the number of whole records
+ *		in padLength and recordCount
+*/
+int openJournal(const char *padName, const char *padId, int lockType, uint64_t *padLength, uint64_t *recordCount){
+	char journalName[4096];
+	unsigned char header[JOURNAL_HEADER_SIZE];
+	struct stat journalInfo;
+	int journalFD = -1;
+
+	snprintf(journalName, sizeof(journalName), "%.*s.%s.journal", (int)(padId - padName), padName, padId);
+
+	journalFD = open(journalName, (lockType == F_WRLCK) ? O_RDWR | O_CREAT : O_RDONLY, 0600);
+	if(journalFD < 0){
+		if(lockType == F_RDLCK){
+			*padLength = measurePad(padName);
+			*recordCount = 0;
+			return -1;
+		}
+		fprintf(stderr, "Error: could not open journal '%s'\n", journalName);
+		exit(1);
+	}
+
+	lockJournal(journalFD, lockType);
+
+	if(fstat(journalFD, &journalInfo) < 0){
+		fprintf(stderr, "Error: could not read journal '%s'\n", journalName);
+		exit(1);
+	}
+
+	// a journal too short to hold its header was never finished, so the pad hasn't been drawn from
+	if(journalInfo.st_size < JOURNAL_HEADER_SIZE){
+		*padLength = measurePad(padName);
+		*recordCount = 0;
+
+		if(lockType == F_WRLCK){
+			packNumber(header, JOURNAL_MAGIC, 4);
+			packNumber(header + 4, JOURNAL_VERSION, 1);
+			packNumber(header + 5, 0, 3);
+			packNumber(header + 8, *padLength, 8);
+
+			if(pwrite(journalFD, header, JOURNAL_HEADER_SIZE, 0) != JOURNAL_HEADER_SIZE){
+				fprintf(stderr, "Error: could not write journal '%s'\n", journalName);
+				exit(1);
+			}
+		}
+
+		return journalFD;
+	}
+
+	if(pread(journalFD, header, JOURNAL_HEADER_SIZE, 0) != JOURNAL_HEADER_SIZE || unpackNumber(header, 4) != JOURNAL_MAGIC || unpackNumber(header + 4, 1) != JOURNAL_VERSION){
+		fprintf(stderr, "Error: '%s' is not a pad journal\n", journalName);
+		exit(1);
+	}
+
+	*padLength = unpackNumber(header + 8, 8);
+	*recordCount = (journalInfo.st_size - JOURNAL_HEADER_SIZE) / JOURNAL_RECORD_SIZE;
+
+	return journalFD;
+}
+
+
+
+
+/*
+ * Function Name: measurePad()
+ * Description: This function finds how many characters a pad holds. Like any key, a pad ends at its
+ *		first newline, and it must only contain characters a key can have.
+ * Preconditions: none
+ * Postconditions: none, the program exits with an error if the pad can't be used
+ * Returns: the pad's length
+*/
+uint64_t measurePad(const char *padName){
+	struct stat padInfo;
+	const char *newline = NULL;
+	void *map = NULL;
+	uint64_t length = 0;
+	int padFD = open(padName, O_RDONLY);
+
+	if(padFD < 0 || fstat(padFD, &padInfo) < 0 || !S_ISREG(padInfo.st_mode) || padInfo.st_size == 0){
+		fprintf(stderr, "Error: could not open pad '%s'\n", padName);
+		exit(1);
+	}
+
+	map = mmap(NULL, padInfo.st_size, PROT_READ, MAP_SHARED, padFD, 0);
+	close(padFD);
+	if(map == MAP_FAILED){
+		fprintf(stderr, "Error: could not map pad '%s'\n", padName);
+		exit(1);
+	}
+
+	newline = memchr(map, '\n', padInfo.st_size);
+	length = (newline == NULL) ? (uint64_t)padInfo.st_size : (uint64_t)(newline - (const char *)map);
+
+	if(otpValidate(map, length) < 0){
+		fprintf(stderr, "Error: pad '%s' contains bad characters\n", padName);
+		exit(1);
+	}
+
+	munmap(map, padInfo.st_size);
+	return length;
+}
+
+
+
+
+/*
+ * Function Name: readRecord()
+ * Description: This function reads one piece from the journal.
+ * Preconditions: The index must be below the journal's record count.
+ * Postconditions: none, the program exits with an error if the record can't be read
+ * Returns: the piece's offset, with its length in length
+*/
+uint64_t readRecord(int journalFD, uint64_t index, uint64_t *length){
+	unsigned char record[JOURNAL_RECORD_SIZE];
+
+	if(pread(journalFD, record, JOURNAL_RECORD_SIZE, JOURNAL_HEADER_SIZE + index * JOURNAL_RECORD_SIZE) != JOURNAL_RECORD_SIZE){
+		fprintf(stderr, "Error: could not read the journal\n");
+		exit(1);
+	}
+
+	*length = unpackNumber(record + 8, 8);
+	return unpackNumber(record, 8);
+}
+
+
+
+
+/*
+ * Function Name: parseLength()
+ * Description: This function reads how many characters a piece should have. A number is taken as it is,
+ *		anything else is a text file and the piece is as long as the text.
+ * Preconditions: none
+ * Postconditions: none, the program exits with an error if the length can't be found
+ * Returns: the length, at least 1
+*/
+uint64_t parseLength(const char *argument){
+	const char *c = argument;
+	unsigned long long length = 0;
+	FILE *textFile = NULL;
+
+	while(isdigit((unsigned char)*c)){
+		c++;
+	}
+
+	// a number too big to hold is an error rather than the biggest one that can be held
+	if(c != argument && *c == '\0'){
+		errno = 0;
+		length = strtoull(argument, NULL, 10);
+		if(errno == ERANGE){
+			fprintf(stderr, "Error: '%s' is too long a length\n", argument);
+			exit(1);
+		}
+	}
+	else{
+		textFile = fopen(argument, "r");
+		if(textFile == NULL){
+			fprintf(stderr, "Error: could not open '%s'\n", argument);
+			exit(1);
+		}
+		length = otpMeasureText(textFile, -1, 0);
+		fclose(textFile);
+	}
+
+	if(length == 0){
+		fprintf(stderr, "Error: '%s' doesn't give a length of at least 1\n", argument);
+		exit(1);
+	}
+
+	return length;
+}
+
+
+
+
+/*
+ * Function Name: listPieces()
+ * Description: This function prints every piece handed out from the pad, as a key reference and a length,
+ *		followed by how much of the pad has been used.
+ * Preconditions: none
+ * Postconditions: The pieces have been printed
+ * Returns: none
+*/
+void listPieces(const char *padName, const char *padId){
+	uint64_t padLength = 0;
+	uint64_t recordCount = 0;
+	uint64_t offset = 0;
+	uint64_t length = 0;
+	uint64_t used = 0;
+	uint64_t i = 0;
+	int journalFD = openJournal(padName, padId, F_RDLCK, &padLength, &recordCount);
+
+	for(i = 0; i < recordCount; i++){
+		offset = readRecord(journalFD, i, &length);
+		fprintf(stdout, "@%s:%llu %llu\n", padId, (unsigned long long)offset, (unsigned long long)length);
+		used = offset + length;
+	}
+
+	fprintf(stdout, "%llu pieces, %llu of %llu characters used\n", (unsigned long long)recordCount, (unsigned long long)used, (unsigned long long)padLength);
+
+	if(journalFD >= 0){
+		close(journalFD);
+	}
+}
+
+
+
+
+/*
+ * Function Name: lockJournal()
+ * Description: This function waits until it holds a lock on the whole journal. The lock is released
+ *		when the journal is closed or the program exits.
+ * Preconditions: lockType must be F_RDLCK or F_WRLCK.
+ * Postconditions: The lock is held, or the program has exited with an error
+ * Returns: none
+*/
+void lockJournal(int journalFD, int lockType){
+	struct flock lock;
+
+	memset(&lock, 0, sizeof(lock));
+	lock.l_type = lockType;
+	lock.l_whence = SEEK_SET;
+	lock.l_start = 0;
+	lock.l_len = 0;
+
+	if(fcntl(journalFD, F_SETLKW, &lock) < 0){
+		perror("Error: could not lock the journal");
+		exit(1);
+	}
+}
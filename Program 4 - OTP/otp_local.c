@@ -0,0 +1,97 @@
+/*
+ * Author: John Olgin
+ * Program Name: otp_local.c
+ * Date: 10/18/26
+ * Description: This program encrypts or decrypts a file with a key using libotp directly, without going
+ *	through a daemon. It reads and prints the same formats as otp_enc and otp_dec, so its output can be
+ *	compared with theirs, and it is an easy way to time the cipher kernels on their own.
+ *		otp_local enc plaintext key > ciphertext
+ *		otp_local dec ciphertext key > plaintext
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "otp_cipher.h"
+
+#define BLOCK_SIZE 65536
+
+
+int main(int argc, char *argv[]){
+
+	// prepare variables to be used in the program
+	// give them all bogus values so I know if they aren't being changed properly
+	long textLength = -1;
+	long keyLength = -1;
+	long remaining = -1;
+	otpKernel cipher = NULL;
+
+	// one block of text and key at a time, so files of any size can be handled
+	static char text[BLOCK_SIZE];
+	static char key[BLOCK_SIZE];
+
+	// ensure the correct arguments were provided
+	if(argc != 4 || (strcmp(argv[1], "enc") != 0 && strcmp(argv[1], "dec") != 0)){
+		fprintf(stderr, "Usage: otp_local enc|dec textfile keyfile\n");
+		exit(1);
+	}
+
+	otpInit();
+	cipher = (strcmp(argv[1], "enc") == 0) ? otpEncrypt : otpDecrypt;
+
+
+
+
+	// open up the files provided on the command line
+	FILE *ptr1 = fopen(argv[2], "r");
+	if(ptr1 == NULL){
+		fprintf(stderr, "Error: could not open '%s'\n", argv[2]);
+		exit(1);
+	}
+
+	FILE *ptr2 = fopen(argv[3], "r");
+	if(ptr2 == NULL){
+		fprintf(stderr, "Error: could not open '%s'\n", argv[3]);
+		exit(1);
+	}
+
+	// validate the text doesn't contain any invalid characters
+	textLength = otpMeasureText(ptr1, -1, 1);
+	if(textLength < 0){
+		fprintf(stderr, "otp_local error: input contains bad characters\n");
+		exit(1);
+	}
+
+	// the key has to be at least as long as the text
+	keyLength = otpMeasureText(ptr2, textLength, 0);
+	if(keyLength < textLength){
+		fprintf(stderr, "Error: key '%s' is too short\n", argv[3]);
+		exit(1);
+	}
+
+	rewind(ptr1);
+	rewind(ptr2);
+
+
+
+
+	// run every block through the cipher and print it
+	for(remaining = textLength; remaining > 0; remaining -= keyLength){
+		keyLength = (remaining < BLOCK_SIZE) ? remaining : BLOCK_SIZE;
+
+		if(fread(text, 1, keyLength, ptr1) != (size_t)keyLength || fread(key, 1, keyLength, ptr2) != (size_t)keyLength){
+			fprintf(stderr, "Error: could not read the input files\n");
+			exit(1);
+		}
+
+		cipher(key, text, text, keyLength);
+		fwrite(text, 1, keyLength, stdout);
+	}
+
+	fputc('\n', stdout);
+
+	fclose(ptr1);
+	fclose(ptr2);
+
+	return 0;
+}
@@ -0,0 +1,528 @@
+/*
+ * Author: John Olgin
+ * Program Name: otp_microbench.c
+ * Date: 10/18/26
+ * Description: This program times the pieces of the cipher on their own, away from any sockets: encryption
+ *	and decryption with every libotp kernel the CPU supports, the character conversions, and the validation
+ *	done by the clients, and the packing of text for the wire. Each one is also timed in its original form (the encrypt(), decrypt(),
+ *	convertToInt()/converToChar() and validateText() functions the daemons and clients started out with,
+ *	copied here unchanged) so any new kernel has to show it is faster than the code it replaces.
+ *		otp_microbench [-r repetitions] [-m max_size] [-l max_legacy_size] [-f function,...]
+ *	Message sizes go from 16 bytes to max_size (64 MB by default) in steps of 4x. Every measurement is
+ *	warmed up first and then repeated, and the mean time per byte is printed with its 95% confidence
+ *	interval. The original functions call strlen() on every pass of their loops, which makes them
+ *	quadratic, so they are only timed up to max_legacy_size (16 KB by default).
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <time.h>
+#include "otp_cipher.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#define MIN_SIZE 16
+#define WARMUP_NANOSECONDS 50000000ULL
+#define BATCH_NANOSECONDS 2000000ULL
+
+// every function timed takes the same arguments, whether or not it uses them all
+typedef void (*benchFunction)(const char key[], const char input[], char output[], size_t length);
+
+// one row of the suite
+struct benchCase {
+	const char *function;
+	const char *variant;
+	benchFunction run;
+	int legacy;
+};
+
+// the result of timing one case at one size
+struct benchResult {
+	double nsPerByte;
+	double interval;
+	double cyclesPerByte;
+};
+
+// keeps the validation results alive so the calls can't be optimized away
+static volatile int validateSink = 0;
+
+void encrypt(char key1[], char fileText[], char encryptText[]);
+void decrypt(char key1[], char fileText[], char encryptText[]);
+int convertToInt(char letter);
+char converToChar(int index);
+int validateText(char plaintext[]);
+void runLegacyEncrypt(const char key[], const char input[], char output[], size_t length);
+void runLegacyDecrypt(const char key[], const char input[], char output[], size_t length);
+void runLegacyConvert(const char key[], const char input[], char output[], size_t length);
+void runLegacyValidate(const char key[], const char input[], char output[], size_t length);
+void runTableConvert(const char key[], const char input[], char output[], size_t length);
+void runValidate(const char key[], const char input[], char output[], size_t length);
+void runPack(const char key[], const char input[], char output[], size_t length);
+void runUnpack(const char key[], const char input[], char output[], size_t length);
+void timeCase(const struct benchCase *benchCase, const char key[], const char input[], char output[], size_t length,
+	int repetitions, struct benchResult *result);
+uint64_t readClock(void);
+uint64_t readCycles(void);
+double tValue(int degrees);
+int wantFunction(const char *filter, const char *function);
+
+
+int main(int argc, char *argv[]){
+
+	// prepare variables to be used in the program
+	// give them all bogus values so I know if they aren't being changed properly
+	int repetitions = 15;
+	size_t maxSize = 64 << 20;
+	size_t maxLegacySize = 16 << 10;
+	const char *filter = NULL;
+	int option = -1;
+	int caseCount = 0;
+	int i = 0;
+	size_t length = 0;
+	size_t position = 0;
+	char *key = NULL;
+	char *input = NULL;
+	char *output = NULL;
+	double legacyNsPerByte[6] = { 0, 0, 0, 0, 0, 0 };
+	const char *functions[] = { "encrypt", "decrypt", "convert", "validate", "pack", "unpack" };
+	struct benchCase cases[24];
+	struct benchResult result;
+	const char *kernels[] = { "scalar", "sse2", "avx2", "avx512" };
+
+	// read the options
+	while((option = getopt(argc, argv, "r:m:l:f:")) != -1){
+		switch(option){
+			case 'r':
+				repetitions = atoi(optarg);
+				break;
+
+			case 'm':
+				maxSize = strtoul(optarg, NULL, 10);
+				break;
+
+			case 'l':
+				maxLegacySize = strtoul(optarg, NULL, 10);
+				break;
+
+			case 'f':
+				filter = optarg;
+				break;
+
+			default:
+				fprintf(stderr, "Usage: otp_microbench [-r repetitions] [-m max_size] [-l max_legacy_size] [-f function,...]\n");
+				exit(1);
+		}
+	}
+
+	if(repetitions < 2 || maxSize < MIN_SIZE){
+		fprintf(stderr, "Error: at least 2 repetitions and a max size of %d are needed\n", MIN_SIZE);
+		exit(1);
+	}
+
+
+
+
+	// the legacy functions need room for a newline and a terminator after the text
+	key = malloc(maxSize + 2);
+	input = malloc(maxSize + 2);
+	output = malloc(maxSize + 2);
+	if(key == NULL || input == NULL || output == NULL){
+		fprintf(stderr, "Error: out of memory\n");
+		exit(1);
+	}
+
+	otpInit();
+	srand(1);
+	for(position = 0; position < maxSize; position++){
+		key[position] = otpCharList[rand() % OTP_ALPHABET_SIZE];
+		input[position] = otpCharList[rand() % OTP_ALPHABET_SIZE];
+	}
+
+	// the original code first, then the table driven versions, then every kernel (packing has no
+	// original, and only a scalar and an AVX2 routine, which the other kernels share)
+	cases[caseCount++] = (struct benchCase){ "encrypt", "legacy", runLegacyEncrypt, 1 };
+	cases[caseCount++] = (struct benchCase){ "decrypt", "legacy", runLegacyDecrypt, 1 };
+	cases[caseCount++] = (struct benchCase){ "convert", "legacy", runLegacyConvert, 1 };
+	cases[caseCount++] = (struct benchCase){ "convert", "table", runTableConvert, 0 };
+	cases[caseCount++] = (struct benchCase){ "validate", "legacy", runLegacyValidate, 1 };
+	cases[caseCount++] = (struct benchCase){ "validate", "libotp", runValidate, 0 };
+	for(i = 0; i < 4; i++){
+		if(otpSelectKernel(kernels[i]) == 0){
+			cases[caseCount++] = (struct benchCase){ "encrypt", kernels[i], otpEncrypt, 0 };
+			cases[caseCount++] = (struct benchCase){ "decrypt", kernels[i], otpDecrypt, 0 };
+		}
+	}
+	for(i = 0; i < 3; i += 2){
+		if(otpSelectKernel(kernels[i]) == 0){
+			cases[caseCount++] = (struct benchCase){ "pack", kernels[i], runPack, 0 };
+			cases[caseCount++] = (struct benchCase){ "unpack", kernels[i], runUnpack, 0 };
+		}
+	}
+
+
+
+
+	printf("%-9s %-7s %10s %10s %9s %12s %9s %10s\n", "function", "variant", "size", "ns/byte", "+/-95%", "cycles/byte",
+		"MB/s", "vs legacy");
+
+	for(length = MIN_SIZE; length <= maxSize; length *= 4){
+		// the original version of each function at this size, to compare the others to
+		memset(legacyNsPerByte, 0, sizeof(legacyNsPerByte));
+
+		for(i = 0; i < caseCount; i++){
+			int functionIndex = 0;
+
+			while(strcmp(functions[functionIndex], cases[i].function) != 0){
+				functionIndex++;
+			}
+
+			if(!wantFunction(filter, cases[i].function) || (cases[i].legacy && length > maxLegacySize)){
+				continue;
+			}
+
+			// the original functions find the end of the text themselves
+			input[length] = '\n';
+			input[length + 1] = '\0';
+
+			// the kernels are switched by name, so pick this case's before timing it
+			if(!cases[i].legacy && (strcmp(cases[i].function, "encrypt") == 0 || strcmp(cases[i].function, "decrypt") == 0 ||
+			   strcmp(cases[i].function, "pack") == 0 || strcmp(cases[i].function, "unpack") == 0)){
+				otpSelectKernel(cases[i].variant);
+			}
+
+			timeCase(&cases[i], key, input, output, length, repetitions, &result);
+
+			input[length] = otpCharList[rand() % OTP_ALPHABET_SIZE];
+			input[length + 1] = otpCharList[rand() % OTP_ALPHABET_SIZE];
+
+			if(cases[i].legacy){
+				legacyNsPerByte[functionIndex] = result.nsPerByte;
+			}
+
+			printf("%-9s %-7s %10zu %10.4f %9.4f %12.3f %9.1f ", cases[i].function, cases[i].variant, length,
+				result.nsPerByte, result.interval, result.cyclesPerByte, 1e3 / result.nsPerByte);
+			if(legacyNsPerByte[functionIndex] > 0 && !cases[i].legacy){
+				printf("%9.1fx\n", legacyNsPerByte[functionIndex] / result.nsPerByte);
+			}
+			else{
+				printf("%10s\n", "-");
+			}
+			fflush(stdout);
+		}
+	}
+
+	free(key);
+	free(input);
+	free(output);
+
+	return 0;
+}
+
+
+/*
+ * Function Name: timeCase()
+ * Description: This function times one case at one size. It is run for a while first to warm up the
+ *		caches and the CPU's clock, then the number of calls per timing is picked so each timing takes
+ *		a couple of milliseconds, and the timing is repeated. The mean of the repetitions and its 95%
+ *		confidence interval are worked out from the per byte times.
+ * Preconditions: The buffers must hold at least length chars, and two more for the legacy functions.
+ * Postconditions: The result holds the mean time per byte, its interval and the cycles per byte
+ * Returns: none
+*/
+void timeCase(const struct benchCase *benchCase, const char key[], const char input[], char output[], size_t length,
+	int repetitions, struct benchResult *result){
+	uint64_t start = 0;
+	uint64_t elapsed = 0;
+	uint64_t cycles = 0;
+	uint64_t callsPerTiming = 1;
+	uint64_t calls = 0;
+	uint64_t call = 0;
+	double sum = 0;
+	double sumSquares = 0;
+	double cycleSum = 0;
+	double sample = 0;
+	double mean = 0;
+	double variance = 0;
+	int i = 0;
+
+	// warm up, and count how many calls fit in the warmup
+	start = readClock();
+	do{
+		benchCase->run(key, input, output, length);
+		calls++;
+		elapsed = readClock() - start;
+	} while(elapsed < WARMUP_NANOSECONDS);
+
+	callsPerTiming = (uint64_t)(BATCH_NANOSECONDS * calls / elapsed);
+	if(callsPerTiming < 1){
+		callsPerTiming = 1;
+	}
+
+	for(i = 0; i < repetitions; i++){
+		start = readClock();
+		cycles = readCycles();
+		for(call = 0; call < callsPerTiming; call++){
+			benchCase->run(key, input, output, length);
+		}
+		cycles = readCycles() - cycles;
+		elapsed = readClock() - start;
+
+		sample = (double)elapsed / callsPerTiming / length;
+		sum += sample;
+		sumSquares += sample * sample;
+		cycleSum += (double)cycles / callsPerTiming / length;
+	}
+
+	mean = sum / repetitions;
+	variance = (sumSquares - repetitions * mean * mean) / (repetitions - 1);
+	if(variance < 0){
+		variance = 0;
+	}
+
+	result->nsPerByte = mean;
+	result->interval = tValue(repetitions - 1) * sqrt(variance / repetitions);
+	result->cyclesPerByte = cycleSum / repetitions;
+}
+
+
+/*
+ * Function Name: readClock()
+ * Description: This function reads the monotonic clock.
+ * Preconditions: none
+ * Postconditions: none
+ * Returns: the time in nanoseconds
+*/
+uint64_t readClock(void){
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+
+/*
+ * Function Name: readCycles()
+ * Description: This function reads the CPU's time stamp counter, which counts at the CPU's base
+ *		clock rate. On other CPUs there's no counter and the cycles are reported as 0.
+ * Preconditions: none
+ * Postconditions: none
+ * Returns: the counter
+*/
+uint64_t readCycles(void){
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	return 0;
+#endif
+}
+
+
+/*
+ * Function Name: tValue()
+ * Description: This function gives Student's t value for a two sided 95% confidence interval.
+ * Preconditions: degrees must be at least 1.
+ * Postconditions: none
+ * Returns: the t value, or the normal distribution's value past 30 degrees of freedom
+*/
+double tValue(int degrees){
+	const double table[30] = { 12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+		2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+		2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042 };
+
+	return (degrees <= 30) ? table[degrees - 1] : 1.960;
+}
+
+
+/*
+ * Function Name: wantFunction()
+ * Description: This function checks a function's name against the -f list.
+ * Preconditions: none
+ * Postconditions: none
+ * Returns: 1 if there's no list or the name is in it, 0 otherwise
+*/
+int wantFunction(const char *filter, const char *function){
+	size_t nameLength = strlen(function);
+	const char *position = filter;
+
+	if(filter == NULL){
+		return 1;
+	}
+
+	while((position = strstr(position, function)) != NULL){
+		if((position == filter || position[-1] == ',') && (position[nameLength] == ',' || position[nameLength] == '\0')){
+			return 1;
+		}
+		position += nameLength;
+	}
+
+	return 0;
+}
+
+
+/*
+ * The wrappers below give every function the same signature so they can all be timed the same way.
+*/
+void runLegacyEncrypt(const char key[], const char input[], char output[], size_t length){
+	(void)length;
+	encrypt((char *)key, (char *)input, output);
+}
+
+void runLegacyDecrypt(const char key[], const char input[], char output[], size_t length){
+	(void)length;
+	decrypt((char *)key, output, (char *)input);
+}
+
+void runLegacyConvert(const char key[], const char input[], char output[], size_t length){
+	size_t i = 0;
+
+	(void)key;
+	for(i = 0; i < length; i++){
+		output[i] = converToChar(convertToInt(input[i]));
+	}
+}
+
+void runTableConvert(const char key[], const char input[], char output[], size_t length){
+	size_t i = 0;
+
+	(void)key;
+	for(i = 0; i < length; i++){
+		output[i] = otpCharList[otpCharIndex[(unsigned char)input[i]]];
+	}
+}
+
+void runLegacyValidate(const char key[], const char input[], char output[], size_t length){
+	(void)key;
+	(void)output;
+	(void)length;
+	validateSink = validateText((char *)input);
+}
+
+void runValidate(const char key[], const char input[], char output[], size_t length){
+	(void)key;
+	(void)output;
+	validateSink = otpValidate(input, length);
+}
+
+void runPack(const char key[], const char input[], char output[], size_t length){
+	(void)key;
+	otpPack(input, (unsigned char *)output, length);
+}
+
+// any bytes unpack to something, so the text is used as packed input as it is
+void runUnpack(const char key[], const char input[], char output[], size_t length){
+	(void)key;
+	otpUnpack((const unsigned char *)input, output, length);
+}
+
+
+/*
+ * The functions below are the original encrypt(), decrypt(), convertToInt(), converToChar() and
+ * validateText(), exactly as they were in otp_enc_d.c, otp_dec_d.c and otp_enc.c, to time against.
+*/
+void encrypt(char key1[], char fileText[], char encryptText[]){
+	int i = 0;
+
+	// read through every character except for the ending newline character
+	for(i = 0; i < strlen(fileText)-1; i++){
+
+		// convert each character from plaintext and key to an integer to prepare for use
+		// in the encryption encryption equation
+		int plain = convertToInt(fileText[i]);
+		fflush(stdout);
+		int key = convertToInt(key1[i]);
+
+		// convert the plaintext and key integers to a newly encrypted integer and
+		// convert it to the appropriate character and add it to the encrypted char array
+		int cipher = (plain + key) % 27;
+		encryptText[i] = converToChar(cipher);
+	}
+
+	// add a newline to the end of the encrypted text string
+	encryptText[i] = '\n';
+}
+
+void decrypt(char key1[], char fileText[], char encryptText[]){
+	int i = 0;
+
+	// read through every character except for the ending newline character
+	for(i = 0; i < strlen(encryptText)-1; i++){
+
+		// convert each character from ciphertext and key to an integer to prepare for use
+		// in the decryption equation
+		int cipher = convertToInt(encryptText[i]);
+		fflush(stdout);
+		int key = convertToInt(key1[i]);
+
+
+		// convert the cipher text and key integers to a newly decrypted integer and
+		// convert it to the appropriate character
+		int plain = (cipher - key) % 27;
+
+		// if the plain text integer is negative, add 27 to get the character integer
+		if(plain < 0){
+			plain += 27;
+		}
+
+		// convert it to the appropriate plain text char and add it to the plain text
+		// char array
+		fileText[i] = converToChar(plain);
+	}
+
+	// add a newline to the end of the decrypted text string
+	fileText[i] = '\n';
+}
+
+int convertToInt(char letter){
+	// Initialize the array that holds all the available characters
+	char list[27] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ ";
+
+	int i = 0;
+
+	// Iterate through the char array of available chars, return the index of the
+	// position where a match is found with the char passed in
+	for(i = 0; i < 27; i++){
+		if(letter == list[i]){
+			return i;
+		}
+	}
+
+	// return negative 1 if no match was found (should not happen)
+	return -1;
+}
+
+char converToChar(int index){
+	// Initialize the array that holds all the available characters
+	char list[27] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ ";
+
+	// Iterate through the char array of available chars, then return the char in the
+	//  position of the index passed in from the encryption function
+	// return -1 if a match isn't found (should not happen)
+	if(index >= 0 && index <= 26){
+		return list[index];
+	}
+	else{
+		return -1;
+	}
+}
+
+int validateText(char plaintext[]){
+	int i = 0;
+
+	// iterate through each character in the plain text string
+	for(i = 0; i < strlen(plaintext)-1; i++){
+		// if the character has an ASCII value lower or higher than the uppercase
+		// letters' ASCII values, and if the char isn't a space, then return -1 to
+		// signal the existance of an invalid char
+		if((plaintext[i] > 90 || plaintext[i] < 65) && plaintext[i] != ' '){
+			return -1;
+		}
+	}
+
+	return 0;
+}
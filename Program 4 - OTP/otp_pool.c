@@ -0,0 +1,890 @@
+/*
+ * Author: John Olgin
+ * Program Name: otp_pool.c
+ * Date: 10/18/26
+ * Description: This is libotpclient, the client side of the protocol packaged for programs that want their
+ *	text encrypted or decrypted in-process instead of running otp_enc or otp_dec for every message. A pool
+ *	keeps up to connectionCount connections to one daemon open for as long as it exists, and spreads the
+ *	submitted jobs over them, with up to depth requests sent ahead on each connection without waiting for
+ *	their answers. Nothing ever blocks: the connects, sends and receives are all non-blocking, and the
+ *	pool only moves forward when the program calls otpPoolPoll(). Each job's chunks are sent straight from
+ *	the caller's text and key, and its result is received straight into the caller's result buffer, so no
+ *	copy of a message is ever made.
+ *	Connections are opened the first time there's work for them, and closed again by otpPoolPoll() once
+ *	they've had none for IDLE_TIMEOUT ms. A connection the daemon doesn't take within CONNECT_TIMEOUT ms,
+ *	or that it drops, is tried again after a wait that doubles every time and is partly random, like the
+ *	otp_enc and otp_dec clients do, and the jobs it hadn't finished go back to the front of the queue. A
+ *	job lost on more than CONNECT_RETRIES connections is finished with OTP_JOB_FAILED, and so is every
+ *	queued job once no connection can be opened at all.
+ *	The pieces otp_enc and otp_dec use as well, to find the daemon, connect to it, wait between tries, send
+ *	their chunks and check the answers, are at the end of the file.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <netdb.h>
+#include "otp_protocol.h"
+#include "otp_cipher.h"
+#include "otp_pool.h"
+
+// the most chunks of text (each with its chunk of key) handed to the socket in one call
+#define SEND_CHUNKS 8
+
+// the most connections a pool can hold
+#define MAX_CONNECTIONS 64
+
+// how long to wait (in ms) for the daemon to take a connection, and how many times a job can be lost
+// with a connection, or a connection can fail in a row, before giving up
+#define CONNECT_TIMEOUT OTP_CONNECT_TIMEOUT
+#define CONNECT_RETRIES OTP_CONNECT_RETRIES
+
+// the wait before each retry starts at BACKOFF_START ms and doubles each time, up to BACKOFF_MAX ms
+#define BACKOFF_START 50
+#define BACKOFF_MAX 2000
+
+// how long (in ms) a connection is kept open with no jobs on it. A daemon with a fixed number of workers
+// serves one connection per worker, so an idle connection holds a worker the others may be waiting for.
+#define IDLE_TIMEOUT 1000
+
+// what receiveAnswers() found when it didn't just read answers
+#define CONNECTION_LOST -1		// the daemon hung up or broke the protocol, the jobs on it count it as a try
+#define CONNECTION_CLOSED -2	// the daemon rejected a job and closed, or closed a connection with no jobs on it
+
+// one of the pool's connections to the daemon
+struct poolConnection {
+	int socketFD;			// -1 while the connection is closed
+	int connecting;			// set until a non-blocking connect has finished
+	long long deadline;		// when a connect gives up, or when a closed connection may try again
+	int failures;			// connects failed and connections lost since an answer last arrived
+	long long idleSince;	// when the last job on it was finished, 0 while it has jobs
+	struct otpJob *first;	// the jobs sent (or being sent) and not answered yet, oldest first
+	struct otpJob *last;
+	int count;
+	int sending;			// set while the last of those still has chunks to queue
+	size_t queued;			// how much of its text has been queued
+	// the send vector points at the request header (and key reference) and then straight into the
+	// caller's text and key, a chunk of text followed by the matching chunk of key each time
+	struct iovec sendVector[2 + 2 * SEND_CHUNKS];
+	int vectorCount;
+	int vectorPosition;
+	unsigned char requestHeader[OTP_REQUEST_HEADER_SIZE];
+	unsigned char keyReference[OTP_KEY_REFERENCE_MAX];
+	unsigned char responseHeader[OTP_RESPONSE_HEADER_SIZE];
+	size_t headerRead;
+	struct otpResponse response;
+	size_t resultReceived;
+	uint32_t firstRequestId;	// the request id of the oldest job waiting
+};
+
+// everything a pool is in the middle of
+struct otpPool {
+	struct sockaddr_storage address;
+	socklen_t addressLength;
+	int operation;
+	int depth;
+	int connectionCount;
+	struct poolConnection connections[MAX_CONNECTIONS];
+	struct otpJob *queueFirst;	// submitted jobs no connection has taken yet, oldest first
+	struct otpJob *queueLast;
+	int pendingCount;
+	unsigned int seed;		// for the random part of the waits
+};
+
+static long long poolClock(void);
+static void startConnect(struct otpPool *pool, struct poolConnection *conn, long long now);
+static void finishConnect(struct otpPool *pool, struct poolConnection *conn, long long now);
+static void dropConnection(struct otpPool *pool, struct poolConnection *conn, int lost, long long now);
+static void queueJobs(struct otpPool *pool, struct poolConnection *conn);
+static void sendJobs(struct poolConnection *conn);
+static int receiveAnswers(struct otpPool *pool, struct poolConnection *conn, int *finished);
+static void finishJob(struct otpPool *pool, struct otpJob *job, int status);
+
+
+/*
+ * Function Name: otpPoolOpen()
+ * Description: This function makes a pool for the daemon at an address, which is a port on this host
+ *		("57171"), a host and port ("otphost:57171") or the path of a Unix domain socket (anything with
+ *		a '/' in it). No connection is opened until there's a job for it.
+ * Preconditions: The operation must be OTP_OP_ENCRYPT or OTP_OP_DECRYPT, and must be the one the daemon
+ *		answers. connectionCount must be 1 to 64 and depth at least 1.
+ * Postconditions: none
+ * Returns: the pool, or NULL if the arguments are bad, the host can't be found or there's no memory
+*/
+struct otpPool *otpPoolOpen(const char *address, int operation, int connectionCount, int depth){
+	struct otpPool *pool = NULL;
+	int i = 0;
+
+	if(address == NULL || (operation != OTP_OP_ENCRYPT && operation != OTP_OP_DECRYPT) ||
+	   connectionCount < 1 || connectionCount > MAX_CONNECTIONS || depth < 1){
+		return NULL;
+	}
+
+	pool = calloc(1, sizeof(struct otpPool));
+	if(pool == NULL){
+		return NULL;
+	}
+
+	if(otpResolveAddress(address, &pool->address, &pool->addressLength) < 0){
+		free(pool);
+		return NULL;
+	}
+
+	pool->operation = operation;
+	pool->depth = depth;
+	pool->connectionCount = connectionCount;
+	pool->seed = time(NULL) ^ getpid();
+	for(i = 0; i < connectionCount; i++){
+		pool->connections[i].socketFD = -1;
+	}
+
+	return pool;
+}
+
+
+/*
+ * Function Name: otpSubmit()
+ * Description: This function hands a job to the pool. The job is only queued here, it's sent once a
+ *		connection has room for it during a later otpPoolPoll(). The text must only hold valid characters,
+ *		the same as for otp_enc and otp_dec.
+ * Preconditions: The job's text, key (or keyId) and result must stay where they are until it's finished,
+ *		and the job must not already be in a pool.
+ * Postconditions: The job's status is OTP_JOB_PENDING
+ * Returns: 0 on success, -1 if the job is bad, in which case it isn't queued
+*/
+int otpSubmit(struct otpPool *pool, struct otpJob *job){
+	if(job->result == NULL || (job->text == NULL && job->length > 0) || otpValidate(job->text, job->length) < 0){
+		return -1;
+	}
+
+	// without a key the job has to name a pad
+	if(job->key == NULL && (job->keyId == NULL || strlen(job->keyId) == 0 || strlen(job->keyId) > OTP_KEY_ID_MAX)){
+		return -1;
+	}
+
+	job->status = OTP_JOB_PENDING;
+	job->attempts = 0;
+	job->next = NULL;
+
+	if(pool->queueLast == NULL){
+		pool->queueFirst = job;
+	}
+	else{
+		pool->queueLast->next = job;
+	}
+	pool->queueLast = job;
+	pool->pendingCount++;
+
+	return 0;
+}
+
+
+/*
+ * Function Name: otpPoolPoll()
+ * Description: This function moves every connection of the pool along as far as it can without blocking.
+ *		Connections are opened where there's work for them, queued jobs are started, whatever the
+ *		sockets will take is sent, and whatever answers have arrived are received. Jobs that finish are
+ *		finished from here, calling their done functions. When nothing can be done straight away it waits
+ *		up to timeout ms (-1 for as long as it takes) for something to happen, like poll().
+ * Preconditions: The pool must have been made by otpPoolOpen(). A done function must not close the pool.
+ * Postconditions: none
+ * Returns: the number of jobs finished, or -1 if poll() failed
+*/
+int otpPoolPoll(struct otpPool *pool, int timeout){
+	struct pollfd pollInfo[MAX_CONNECTIONS];
+	struct poolConnection *conn = NULL;
+	long long now = poolClock();
+	long long wake = -1;
+	int finished = 0;
+	int result = 0;
+	int i = 0;
+
+	for(i = 0; i < pool->connectionCount; i++){
+		conn = &pool->connections[i];
+
+		if(conn->socketFD < 0 && pool->queueFirst != NULL && now >= conn->deadline){
+			startConnect(pool, conn, now);
+		}
+		if(conn->socketFD >= 0 && !conn->connecting && conn->vectorPosition == conn->vectorCount){
+			queueJobs(pool, conn);
+		}
+
+		// close a connection that has had nothing to do for a while
+		if(conn->socketFD >= 0 && !conn->connecting && conn->count == 0){
+			if(conn->idleSince == 0){
+				conn->idleSince = now;
+			}
+			else if(now - conn->idleSince >= IDLE_TIMEOUT){
+				dropConnection(pool, conn, 0, now);
+			}
+		}
+		else{
+			conn->idleSince = 0;
+		}
+
+		// an open connection is always watched, so one the daemon closes while idle is noticed
+		pollInfo[i].fd = conn->socketFD;
+		pollInfo[i].events = conn->connecting ? POLLOUT : POLLIN;
+		if(conn->socketFD >= 0 && !conn->connecting && conn->vectorPosition < conn->vectorCount){
+			pollInfo[i].events |= POLLOUT;
+		}
+		pollInfo[i].revents = 0;
+
+		// wake up in time for a connect to give up, a closed connection to try again, or an idle one to close
+		if((conn->connecting || (conn->socketFD < 0 && pool->queueFirst != NULL)) && (wake < 0 || conn->deadline < wake)){
+			wake = conn->deadline;
+		}
+		if(conn->idleSince != 0 && (wake < 0 || conn->idleSince + IDLE_TIMEOUT < wake)){
+			wake = conn->idleSince + IDLE_TIMEOUT;
+		}
+	}
+
+	// with nothing to do there's nothing to wait for either
+	if(pool->pendingCount == 0){
+		return 0;
+	}
+
+	if(wake >= 0 && (timeout < 0 || wake - now < timeout)){
+		timeout = (wake > now) ? (int)(wake - now) : 0;
+	}
+
+	if(poll(pollInfo, pool->connectionCount, timeout) < 0){
+		return (errno == EINTR) ? 0 : -1;
+	}
+
+	now = poolClock();
+	for(i = 0; i < pool->connectionCount; i++){
+		conn = &pool->connections[i];
+
+		if(conn->connecting){
+			if(pollInfo[i].revents){
+				finishConnect(pool, conn, now);
+			}
+			else if(now >= conn->deadline){
+				dropConnection(pool, conn, 1, now);
+			}
+			continue;
+		}
+		if(conn->socketFD < 0){
+			continue;
+		}
+
+		if(pollInfo[i].revents & (POLLIN | POLLHUP | POLLERR)){
+			result = receiveAnswers(pool, conn, &finished);
+			if(result < 0){
+				dropConnection(pool, conn, result == CONNECTION_LOST, now);
+				continue;
+			}
+		}
+
+		if(pollInfo[i].revents & POLLOUT){
+			sendJobs(conn);
+		}
+	}
+
+	return finished;
+}
+
+
+/*
+ * Function Name: otpPoolWait()
+ * Description: This function polls the pool until one job is finished. Other jobs may finish (and have
+ *		their done functions called) in the meantime.
+ * Preconditions: The job must have been submitted to the pool.
+ * Postconditions: The job is finished
+ * Returns: the job's status
+*/
+int otpPoolWait(struct otpPool *pool, struct otpJob *job){
+	while(job->status == OTP_JOB_PENDING){
+		if(otpPoolPoll(pool, -1) < 0){
+			return OTP_JOB_FAILED;
+		}
+	}
+
+	return job->status;
+}
+
+
+/*
+ * Function Name: otpPoolPending()
+ * Description: This function tells how many jobs have been submitted to the pool and not finished.
+ * Preconditions: none
+ * Postconditions: none
+ * Returns: the number of jobs
+*/
+int otpPoolPending(const struct otpPool *pool){
+	return pool->pendingCount;
+}
+
+
+/*
+ * Function Name: otpPoolClose()
+ * Description: This function closes every connection of a pool and frees it. Any job not finished yet is
+ *		finished with OTP_JOB_FAILED, and its done function called as usual.
+ * Preconditions: It must not be called from a done function.
+ * Postconditions: The pool can no longer be used
+ * Returns: none
+*/
+void otpPoolClose(struct otpPool *pool){
+	struct otpJob *job = NULL;
+	int i = 0;
+
+	if(pool == NULL){
+		return;
+	}
+
+	for(i = 0; i < pool->connectionCount; i++){
+		if(pool->connections[i].socketFD >= 0){
+			close(pool->connections[i].socketFD);
+		}
+		while((job = pool->connections[i].first) != NULL){
+			pool->connections[i].first = job->next;
+			finishJob(pool, job, OTP_JOB_FAILED);
+		}
+	}
+
+	while((job = pool->queueFirst) != NULL){
+		pool->queueFirst = job->next;
+		finishJob(pool, job, OTP_JOB_FAILED);
+	}
+
+	free(pool);
+}
+
+
+/*
+ * Function Name: poolClock()
+ * Description: This function reads a clock that only ever goes forward, for the connect and retry deadlines.
+ * Preconditions: none
+ * Postconditions: none
+ * Returns: the time in ms
+*/
+static long long poolClock(void){
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (long long)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+
+/*
+ * Function Name: startConnect()
+ * Description: This function starts a non-blocking connect to the daemon on a closed connection.
+ *		otpPoolPoll() waits for it to finish along with everything else.
+ * Preconditions: The connection must be closed.
+ * Postconditions: The connection is connecting, or open, or closed again to be retried later
+ * Returns: none
+*/
+static void startConnect(struct otpPool *pool, struct poolConnection *conn, long long now){
+	conn->socketFD = otpStartConnect(&pool->address, pool->addressLength);
+	if(conn->socketFD < 0){
+		dropConnection(pool, conn, 1, now);
+		return;
+	}
+
+	// even a connect that finished straight away is only checked once poll() says the socket is ready
+	conn->connecting = 1;
+	conn->deadline = now + CONNECT_TIMEOUT;
+}
+
+
+/*
+ * Function Name: finishConnect()
+ * Description: This function checks how a non-blocking connect turned out.
+ * Preconditions: The connection must be connecting, and poll() must have said the socket is ready.
+ * Postconditions: The connection is open, or closed to be retried later
+ * Returns: none
+*/
+static void finishConnect(struct otpPool *pool, struct poolConnection *conn, long long now){
+	if(otpFinishConnect(conn->socketFD) < 0){
+		dropConnection(pool, conn, 1, now);
+		return;
+	}
+
+	conn->connecting = 0;
+}
+
+
+/*
+ * Function Name: dropConnection()
+ * Description: This function closes a connection and puts the jobs it hadn't finished back at the front
+ *		of the queue, in the order they were submitted. If the connection was lost, rather than closed by
+ *		the daemon for a reason of its own, every one of those jobs counts it as a try, a job that has had
+ *		too many is finished with OTP_JOB_FAILED, and the connection waits a while before it's opened
+ *		again. A job whose result was being written over its own text can't be sent again once part of
+ *		the result is in, so it fails as well. If no connection of the pool can be opened at all, every
+ *		queued job fails rather than waiting forever.
+ * Preconditions: The connection must be open or connecting.
+ * Postconditions: The connection is closed with nothing on it
+ * Returns: none
+*/
+static void dropConnection(struct otpPool *pool, struct poolConnection *conn, int lost, long long now){
+	struct otpJob *job = conn->first;
+	struct otpJob *next = NULL;
+	struct otpJob *retryFirst = NULL;
+	struct otpJob *retryLast = NULL;
+	int failures = 0;
+	int i = 0;
+
+	if(conn->socketFD >= 0){
+		close(conn->socketFD);
+	}
+
+	for(; job != NULL; job = next){
+		next = job->next;
+		job->next = NULL;
+
+		if(lost){
+			job->attempts++;
+		}
+		if(job->attempts > CONNECT_RETRIES || (job == conn->first && job->result == job->text && conn->headerRead == OTP_RESPONSE_HEADER_SIZE && conn->resultReceived > 0)){
+			finishJob(pool, job, OTP_JOB_FAILED);
+			continue;
+		}
+
+		if(retryLast == NULL){
+			retryFirst = job;
+		}
+		else{
+			retryLast->next = job;
+		}
+		retryLast = job;
+	}
+
+	// the jobs from the connection go ahead of everything submitted after them
+	if(retryLast != NULL){
+		retryLast->next = pool->queueFirst;
+		pool->queueFirst = retryFirst;
+		if(pool->queueLast == NULL){
+			pool->queueLast = retryLast;
+		}
+	}
+
+	failures = conn->failures;
+	memset(conn, 0, sizeof(struct poolConnection));
+	conn->socketFD = -1;
+	conn->deadline = now;
+	conn->failures = failures;
+	if(!lost){
+		return;
+	}
+
+	// wait longer after every failure in a row
+	conn->failures++;
+	conn->deadline = now + otpBackoffDelay(conn->failures, &pool->seed);
+
+	// the queue is only given up on once every connection has failed too often in a row
+	for(i = 0; i < pool->connectionCount; i++){
+		if(pool->connections[i].socketFD >= 0 || pool->connections[i].failures <= CONNECT_RETRIES){
+			return;
+		}
+	}
+
+	// the queue is taken off the pool first, so a done function that submits again starts a new one
+	job = pool->queueFirst;
+	pool->queueFirst = NULL;
+	pool->queueLast = NULL;
+	for(; job != NULL; job = next){
+		next = job->next;
+		finishJob(pool, job, OTP_JOB_FAILED);
+	}
+
+	for(i = 0; i < pool->connectionCount; i++){
+		pool->connections[i].failures = 0;
+	}
+}
+
+
+/*
+ * Function Name: queueJobs()
+ * Description: This function fills a connection's send vector once the last of it has been sent. When the
+ *		job being sent has no chunks left, the next queued job is started, and then its header and as
+ *		many chunks as fit are queued.
+ * Preconditions: The connection must be open, and everything the send vector held must have been sent.
+ * Postconditions: The send vector holds whatever the connection should send next, which may be nothing
+ * Returns: none
+*/
+static void queueJobs(struct otpPool *pool, struct poolConnection *conn){
+	struct otpJob *job = conn->last;
+	struct otpRequest request;
+	size_t chunkLength = 0;
+
+	conn->vectorCount = 0;
+	conn->vectorPosition = 0;
+
+	if(conn->sending && conn->queued == job->length){
+		conn->sending = 0;
+	}
+
+	// once a job is sent, take on the next one unless too many are still waiting for their answers
+	if(!conn->sending && conn->count < pool->depth && pool->queueFirst != NULL){
+		job = pool->queueFirst;
+		pool->queueFirst = job->next;
+		if(pool->queueFirst == NULL){
+			pool->queueLast = NULL;
+		}
+
+		job->next = NULL;
+		if(conn->last == NULL){
+			conn->first = job;
+		}
+		else{
+			conn->last->next = job;
+		}
+		conn->last = job;
+		conn->count++;
+
+		request.magic = OTP_MAGIC;
+		request.version = OTP_VERSION;
+		request.operation = pool->operation;
+		request.flags = 0;
+		request.requestId = conn->firstRequestId + conn->count - 1;
+		request.payloadLength = job->length;
+		request.keyLength = job->length;
+
+		conn->sendVector[0].iov_base = conn->requestHeader;
+		conn->sendVector[0].iov_len = OTP_REQUEST_HEADER_SIZE;
+		conn->vectorCount = 1;
+
+		// a key reference goes right behind the header, in place of the key chunks
+		if(job->key == NULL){
+			request.flags = OTP_FLAG_KEY_ID;
+			request.keyLength = packKeyReference(job->keyId, strlen(job->keyId), job->keyOffset, conn->keyReference);
+			conn->sendVector[1].iov_base = conn->keyReference;
+			conn->sendVector[1].iov_len = request.keyLength;
+			conn->vectorCount = 2;
+		}
+		packRequest(&request, conn->requestHeader);
+
+		conn->sending = 1;
+		conn->queued = 0;
+	}
+
+	// queue the next chunks, right behind the header if a job was just started so both go out together
+	while(conn->sending && conn->queued < job->length && conn->vectorCount + 2 <= 2 + 2 * SEND_CHUNKS){
+		chunkLength = (job->length - conn->queued < CHUNK_SIZE) ? job->length - conn->queued : CHUNK_SIZE;
+
+		conn->sendVector[conn->vectorCount].iov_base = (char *)job->text + conn->queued;
+		conn->sendVector[conn->vectorCount].iov_len = chunkLength;
+		conn->vectorCount++;
+
+		if(job->key != NULL){
+			conn->sendVector[conn->vectorCount].iov_base = (char *)job->key + conn->queued;
+			conn->sendVector[conn->vectorCount].iov_len = chunkLength;
+			conn->vectorCount++;
+		}
+
+		conn->queued += chunkLength;
+	}
+}
+
+
+/*
+ * Function Name: sendJobs()
+ * Description: This function sends as much of a connection's send vector as the socket will take.
+ * Preconditions: The socket must be ready for writing.
+ * Postconditions: The send vector has been stepped past whatever was sent
+ * Returns: none
+*/
+static void sendJobs(struct poolConnection *conn){
+	// a failed send shows up as a hang up on the next poll
+	otpSendVector(conn->socketFD, conn->sendVector, &conn->vectorPosition, conn->vectorCount);
+}
+
+
+/*
+ * Function Name: receiveAnswers()
+ * Description: This function reads everything the daemon has sent back on a connection. Each response
+ *		header comes first and says whether the daemon accepted the oldest job waiting, then its result is
+ *		received straight into the job's result buffer. Every job whose result is complete is finished.
+ * Preconditions: The connection must be open.
+ * Postconditions: finished has been increased by the number of jobs finished
+ * Returns: 0, CONNECTION_CLOSED if the daemon rejected a job or closed an idle connection, or
+ *		CONNECTION_LOST if it hung up or the answer isn't the one expected
+*/
+static int receiveAnswers(struct otpPool *pool, struct poolConnection *conn, int *finished){
+	struct otpJob *job = NULL;
+	ssize_t charsRead = -1;
+	int status = OTP_STATUS_OK;
+
+	while(1){
+		job = conn->first;
+
+		// nothing is expected on an idle connection, so it's the daemon closing it
+		if(job == NULL){
+			charsRead = recv(conn->socketFD, conn->responseHeader, OTP_RESPONSE_HEADER_SIZE, MSG_DONTWAIT);
+			if(charsRead < 0 && (errno == EAGAIN || errno == EINTR)){
+				return 0;
+			}
+			return (charsRead == 0) ? CONNECTION_CLOSED : CONNECTION_LOST;
+		}
+
+		if(conn->headerRead < OTP_RESPONSE_HEADER_SIZE){
+			charsRead = recv(conn->socketFD, conn->responseHeader + conn->headerRead, OTP_RESPONSE_HEADER_SIZE - conn->headerRead, MSG_DONTWAIT);
+			if(charsRead <= 0){
+				break;
+			}
+
+			conn->headerRead += charsRead;
+			if(conn->headerRead < OTP_RESPONSE_HEADER_SIZE){
+				continue;
+			}
+
+			// the daemon closes the connection after turning a request down
+			status = otpCheckResponse(conn->responseHeader, &conn->response, conn->firstRequestId, job->length);
+			if(status < 0){
+				return CONNECTION_LOST;
+			}
+			if(status != OTP_STATUS_OK){
+				conn->first = job->next;
+				conn->count--;
+				finishJob(pool, job, status);
+				(*finished)++;
+				return CONNECTION_CLOSED;
+			}
+			conn->resultReceived = 0;
+		}
+		else{
+			charsRead = recv(conn->socketFD, job->result + conn->resultReceived, job->length - conn->resultReceived, MSG_DONTWAIT);
+			if(charsRead <= 0){
+				break;
+			}
+			conn->resultReceived += charsRead;
+		}
+
+		if(conn->resultReceived == job->length){
+			conn->first = job->next;
+			if(conn->first == NULL){
+				conn->last = NULL;
+			}
+
+			// a job can be answered before the send vector that held its last chunk is refilled
+			if(conn->sending && conn->last == NULL){
+				conn->sending = 0;
+			}
+
+			conn->count--;
+			conn->firstRequestId++;
+			conn->headerRead = 0;
+			conn->resultReceived = 0;
+			conn->failures = 0;
+			finishJob(pool, job, OTP_STATUS_OK);
+			(*finished)++;
+		}
+	}
+
+	if(charsRead == 0 || (errno != EAGAIN && errno != EINTR)){
+		return CONNECTION_LOST;
+	}
+
+	return 0;
+}
+
+
+/*
+ * Function Name: finishJob()
+ * Description: This function records how a job ended and tells the caller, through its done function if
+ *		it has one.
+ * Preconditions: The job must no longer be in any queue.
+ * Postconditions: The job belongs to the caller again
+ * Returns: none
+*/
+static void finishJob(struct otpPool *pool, struct otpJob *job, int status){
+	job->status = status;
+	job->next = NULL;
+	pool->pendingCount--;
+
+	if(job->done != NULL){
+		job->done(job);
+	}
+}
+
+
+/*
+ * Function Name: otpResolveAddress()
+ * Description: This function works out the socket address of a daemon, which is a port on this host
+ *		("57171"), a host and port ("otphost:57171") or the path of a Unix domain socket (anything with a
+ *		'/' in it). A host is only looked up here, however many connections are opened to it later.
+ * Preconditions: none
+ * Postconditions: socketAddress and addressLength hold the daemon's address
+ * Returns: 0 on success, -1 if the address is bad or the host can't be found
+*/
+int otpResolveAddress(const char *address, struct sockaddr_storage *socketAddress, socklen_t *addressLength){
+	struct sockaddr_un *socketPath = (struct sockaddr_un *)socketAddress;
+	struct addrinfo hints;
+	struct addrinfo *found = NULL;
+	const char *colon = strrchr(address, ':');
+	const char *port = address;
+	char host[256] = "localhost";
+
+	memset(socketAddress, 0, sizeof(struct sockaddr_storage));
+
+	// a path means the daemon is on a Unix domain socket
+	if(strchr(address, '/') != NULL){
+		if(strlen(address) >= sizeof(socketPath->sun_path)){
+			return -1;
+		}
+		socketPath->sun_family = AF_UNIX;
+		strcpy(socketPath->sun_path, address);
+		*addressLength = sizeof(struct sockaddr_un);
+		return 0;
+	}
+
+	if(colon != NULL){
+		if((size_t)(colon - address) >= sizeof(host)){
+			return -1;
+		}
+		memcpy(host, address, colon - address);
+		host[colon - address] = '\0';
+		port = colon + 1;
+	}
+
+	// the daemons only listen on IPv4
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_INET;
+	hints.ai_socktype = SOCK_STREAM;
+	if(getaddrinfo(host, port, &hints, &found) != 0){
+		return -1;
+	}
+
+	memcpy(socketAddress, found->ai_addr, found->ai_addrlen);
+	*addressLength = found->ai_addrlen;
+	freeaddrinfo(found);
+
+	return 0;
+}
+
+
+/*
+ * Function Name: otpStartConnect()
+ * Description: This function opens a non-blocking socket and starts connecting it to the daemon. The
+ *		caller waits for the socket to be ready for writing, then calls otpFinishConnect().
+ * Preconditions: The address must have come from otpResolveAddress().
+ * Postconditions: none
+ * Returns: the socket, or -1 if it couldn't be opened or the daemon turned the connection away at once
+*/
+int otpStartConnect(const struct sockaddr_storage *socketAddress, socklen_t addressLength){
+	int socketFD = socket(socketAddress->ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+
+	if(socketFD < 0){
+		return -1;
+	}
+
+	if(connect(socketFD, (const struct sockaddr *)socketAddress, addressLength) < 0 && errno != EINPROGRESS){
+		close(socketFD);
+		return -1;
+	}
+
+	return socketFD;
+}
+
+
+/*
+ * Function Name: otpFinishConnect()
+ * Description: This function checks how a connect started by otpStartConnect() turned out.
+ * Preconditions: poll() must have said the socket is ready for writing.
+ * Postconditions: The socket is left open either way, for the caller to close
+ * Returns: 0 if the socket is connected, -1 if not
+*/
+int otpFinishConnect(int socketFD){
+	socklen_t errorLength = sizeof(int);
+	int error = 0;
+	int noDelay = 1;
+
+	if(getsockopt(socketFD, SOL_SOCKET, SO_ERROR, &error, &errorLength) < 0 || error != 0){
+		return -1;
+	}
+
+	// requests are often small and sent back to back, so don't let Nagle hold them (a Unix
+	// domain socket just refuses the option)
+	setsockopt(socketFD, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+	return 0;
+}
+
+
+/*
+ * Function Name: otpBackoffDelay()
+ * Description: This function works out how long to wait before another try. The wait doubles with every
+ *		attempt, from BACKOFF_START ms up to BACKOFF_MAX ms, and a random amount of up to half of it is
+ *		taken off, so many clients turned away at once don't all come back at the same moment.
+ * Preconditions: The first retry is attempt 1. The seed belongs to the caller, for rand_r().
+ * Postconditions: The seed has moved on
+ * Returns: the wait in ms
+*/
+long otpBackoffDelay(int attempt, unsigned int *seed){
+	long delay = BACKOFF_MAX;
+
+	if(attempt < 16 && ((long)BACKOFF_START << (attempt - 1)) < BACKOFF_MAX){
+		delay = (long)BACKOFF_START << (attempt - 1);
+	}
+
+	return delay - rand_r(seed) % (delay / 2 + 1);
+}
+
+
+/*
+ * Function Name: otpSendVector()
+ * Description: This function sends as much of a send vector as the socket will take, without blocking.
+ * Preconditions: position must be where the last call left it (0 for a new vector), and at most count.
+ * Postconditions: The vector has been stepped past whatever was sent, position included, so the next
+ *		call carries on from there
+ * Returns: none
+*/
+void otpSendVector(int socketFD, struct iovec vector[], int *position, int count){
+	struct msghdr sendMessage;
+	ssize_t charsWritten = -1;
+
+	memset(&sendMessage, 0, sizeof(sendMessage));
+	sendMessage.msg_iov = vector + *position;
+	sendMessage.msg_iovlen = count - *position;
+
+	charsWritten = sendmsg(socketFD, &sendMessage, MSG_DONTWAIT | MSG_NOSIGNAL);
+
+	// step past every piece that was sent, and into the one that was cut short
+	while(charsWritten > 0 && *position < count){
+		if((size_t)charsWritten >= vector[*position].iov_len){
+			charsWritten -= vector[*position].iov_len;
+			(*position)++;
+		}
+		else{
+			vector[*position].iov_base = (char *)vector[*position].iov_base + charsWritten;
+			vector[*position].iov_len -= charsWritten;
+			charsWritten = 0;
+		}
+	}
+}
+
+
+/*
+ * Function Name: otpCheckResponse()
+ * Description: This function unpacks a response header and checks it answers the request expected.
+ * Preconditions: The header must be complete.
+ * Postconditions: response holds the unpacked header
+ * Returns: OTP_STATUS_OK, the status the daemon rejected the request with, OTP_STATUS_BAD_VERSION if it
+ *		isn't an otp daemon at all, or -1 if the id or length isn't the one expected
+*/
+int otpCheckResponse(const unsigned char header[], struct otpResponse *response, uint32_t requestId, uint64_t length){
+	unpackResponse(header, response);
+
+	if(response->magic != OTP_MAGIC || response->version != OTP_VERSION){
+		return OTP_STATUS_BAD_VERSION;
+	}
+	if(response->status != OTP_STATUS_OK){
+		return response->status;
+	}
+	if(response->requestId != requestId || response->length != length){
+		return -1;
+	}
+
+	return OTP_STATUS_OK;
+}
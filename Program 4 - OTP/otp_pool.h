@@ -0,0 +1,79 @@
+/*
+ * Author: John Olgin
+ * Program Name: otp_pool.h
+ * Date: 10/18/26
+ * Description: This is the interface to libotpclient, which lets a program have text encrypted or decrypted
+ *	by otp_enc_d or otp_dec_d itself, without running otp_enc or otp_dec. A pool holds a few persistent
+ *	connections to one daemon. Each piece of work is a job, which is submitted to the pool and finished
+ *	later, while the program carries on. The program drives the pool by calling otpPoolPoll() (from its
+ *	own loop, or with a timeout when it has nothing else to do), and finds out a job is finished either
+ *	by its done function being called or by its status no longer being OTP_JOB_PENDING.
+ *
+ *		struct otpPool *pool = otpPoolOpen("57171", OTP_OP_ENCRYPT, 4, 16);
+ *		struct otpJob job = { .text = text, .key = key, .length = length, .result = result };
+ *		otpSubmit(pool, &job);
+ *		while(job.status == OTP_JOB_PENDING){
+ *			otpPoolPoll(pool, -1);
+ *		}
+ *
+ *	Programs using it link with "-lotpclient -lotp".
+ *	The library also holds the pieces of the client side otp_enc and otp_dec share with the pool: finding
+ *	the daemon's address, connecting to it, waiting between retries, sending a vector of chunks and
+ *	checking a response header.
+*/
+
+#ifndef OTP_POOL_H
+#define OTP_POOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include "otp_protocol.h"
+
+// how long to wait (in ms) for the daemon to take a connection, and how many more tries a connection
+// gets, unless otp_enc and otp_dec are told otherwise
+#define OTP_CONNECT_TIMEOUT 5000
+#define OTP_CONNECT_RETRIES 3
+
+// a job's status until it's finished, when it becomes the status the daemon answered with
+// (OTP_STATUS_OK or one of the others) or OTP_JOB_FAILED
+#define OTP_JOB_PENDING -1
+#define OTP_JOB_FAILED -2		// the daemon couldn't be reached, or kept dropping the connection
+
+// one piece of work. The caller fills in the first part, and keeps the job, its text, key and result
+// where they are until it's finished.
+struct otpJob {
+	const char *text;
+	const char *key;		// length chars of key, or NULL if keyId names a pad the daemon holds
+	const char *keyId;		// the pad's id, when there is no key
+	uint64_t keyOffset;		// where in the pad the key starts
+	size_t length;
+	char *result;			// room for length chars, which may be the text itself
+	void (*done)(struct otpJob *job);	// called from otpPoolPoll() once the job is finished, or NULL
+	void *context;			// the caller's own, the pool never touches it
+
+	// filled in by the pool
+	int status;
+	int attempts;			// how many connections the job has been lost on
+	struct otpJob *next;
+};
+
+struct otpPool;
+
+struct otpPool *otpPoolOpen(const char *address, int operation, int connectionCount, int depth);
+int otpSubmit(struct otpPool *pool, struct otpJob *job);
+int otpPoolPoll(struct otpPool *pool, int timeout);
+int otpPoolWait(struct otpPool *pool, struct otpJob *job);
+int otpPoolPending(const struct otpPool *pool);
+void otpPoolClose(struct otpPool *pool);
+
+int otpResolveAddress(const char *address, struct sockaddr_storage *socketAddress, socklen_t *addressLength);
+int otpStartConnect(const struct sockaddr_storage *socketAddress, socklen_t addressLength);
+int otpFinishConnect(int socketFD);
+long otpBackoffDelay(int attempt, unsigned int *seed);
+void otpSendVector(int socketFD, struct iovec vector[], int *position, int count);
+int otpCheckResponse(const unsigned char header[], struct otpResponse *response, uint32_t requestId, uint64_t length);
+
+#endif
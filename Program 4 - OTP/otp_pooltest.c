@@ -0,0 +1,268 @@
+/*
+ * Author: John Olgin
+ * Program Name: otp_pooltest.c
+ * Date: 10/18/26
+ * Description: This program checks libotpclient against a running daemon. It cuts a text into jobs of
+ *	different lengths, from a single character to several chunks, and has a pool encrypt or decrypt them
+ *	all at once. Every other job has its result written over its own text. Once every job is finished, the
+ *	results put back together must be exactly what otp_local prints for the same text and key.
+ *		otp_pooltest enc plaintext key port|path [connections [depth]]
+ *		otp_pooltest dec ciphertext key port|path [connections [depth]]
+ *	otp_local is run from the same directory as otp_pooltest. The program prints how many jobs matched
+ *	and exits with 0, or says what went wrong and exits with 1.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include "otp_protocol.h"
+#include "otp_pool.h"
+
+// the most jobs the text is cut into
+#define MAX_JOBS 4096
+
+char *readText(const char *fileName, size_t *length);
+char *runLocal(const char *program, char *argv[], size_t *length);
+void jobDone(struct otpJob *job);
+
+
+int main(int argc, char *argv[]){
+
+	// prepare variables to be used in the program
+	// give them all bogus values so I know if they aren't being changed properly
+	static struct otpJob jobs[MAX_JOBS];
+	struct otpPool *pool = NULL;
+	char *text = NULL;
+	char *key = NULL;
+	char *result = NULL;
+	char *expected = NULL;
+	char localPath[4096];
+	char *localArgs[5];
+	const char *slash = NULL;
+	size_t textLength = 0;
+	size_t keyLength = 0;
+	size_t expectedLength = 0;
+	size_t offset = 0;
+	unsigned int seed = 1;
+	int connectionCount = 4;
+	int depth = 16;
+	int jobCount = 0;
+	int doneCount = 0;
+	int i = 0;
+
+	// ensure the correct arguments were provided
+	if(argc < 5 || argc > 7 || (strcmp(argv[1], "enc") != 0 && strcmp(argv[1], "dec") != 0)){
+		fprintf(stderr, "Usage: otp_pooltest enc|dec textfile keyfile port|path [connections [depth]]\n");
+		exit(1);
+	}
+	if(argc > 5){
+		connectionCount = atoi(argv[5]);
+	}
+	if(argc > 6){
+		depth = atoi(argv[6]);
+	}
+
+	text = readText(argv[2], &textLength);
+	key = readText(argv[3], &keyLength);
+	if(keyLength < textLength){
+		fprintf(stderr, "Error: key '%s' is too short\n", argv[3]);
+		exit(1);
+	}
+
+	// the results are put together here, the jobs that work in place start from a copy of the text
+	result = malloc(textLength + 1);
+	if(result == NULL){
+		fprintf(stderr, "Error: out of memory\n");
+		exit(1);
+	}
+	memcpy(result, text, textLength);
+
+	pool = otpPoolOpen(argv[4], (strcmp(argv[1], "enc") == 0) ? OTP_OP_ENCRYPT : OTP_OP_DECRYPT, connectionCount, depth);
+	if(pool == NULL){
+		fprintf(stderr, "Error: could not make a pool for '%s'\n", argv[4]);
+		exit(1);
+	}
+
+
+
+
+	// cut the text into jobs, mostly short ones with the odd one running over several chunks, and
+	// the last job takes whatever is left
+	for(offset = 0; offset < textLength; jobCount++){
+		jobs[jobCount].length = (rand_r(&seed) % 4 == 0) ? (size_t)(rand_r(&seed) % (3 * CHUNK_SIZE)) + 1 : (size_t)(rand_r(&seed) % 512) + 1;
+		if(jobCount == MAX_JOBS - 1 || jobs[jobCount].length > textLength - offset){
+			jobs[jobCount].length = textLength - offset;
+		}
+
+		jobs[jobCount].text = (jobCount % 2 == 0) ? text + offset : result + offset;
+		jobs[jobCount].key = key + offset;
+		jobs[jobCount].result = result + offset;
+		jobs[jobCount].done = jobDone;
+		jobs[jobCount].context = &doneCount;
+
+		if(otpSubmit(pool, &jobs[jobCount]) < 0){
+			fprintf(stderr, "otp_pooltest error: input contains bad characters\n");
+			exit(1);
+		}
+		offset += jobs[jobCount].length;
+	}
+
+	while(otpPoolPending(pool) > 0){
+		if(otpPoolPoll(pool, -1) < 0){
+			perror("Error: could not poll the pool");
+			exit(1);
+		}
+	}
+	otpPoolClose(pool);
+
+
+
+
+	// every job must have finished once, and well
+	for(i = 0; i < jobCount; i++){
+		if(jobs[i].status != OTP_STATUS_OK){
+			fprintf(stderr, "Error: job %d finished with status %d\n", i, jobs[i].status);
+			exit(1);
+		}
+	}
+	if(doneCount != jobCount){
+		fprintf(stderr, "Error: %d of %d done functions were called\n", doneCount, jobCount);
+		exit(1);
+	}
+
+	// otp_local lives next to this program
+	slash = strrchr(argv[0], '/');
+	snprintf(localPath, sizeof(localPath), "%.*sotp_local", (slash != NULL) ? (int)(slash - argv[0] + 1) : 0, argv[0]);
+	localArgs[0] = localPath;
+	localArgs[1] = argv[1];
+	localArgs[2] = argv[2];
+	localArgs[3] = argv[3];
+	localArgs[4] = NULL;
+	expected = runLocal(localPath, localArgs, &expectedLength);
+
+	// otp_local ends its result with a newline
+	result[textLength] = '\n';
+	if(expectedLength != textLength + 1 || memcmp(result, expected, expectedLength) != 0){
+		fprintf(stderr, "Error: the pool's results don't match otp_local's\n");
+		exit(1);
+	}
+
+	printf("otp_pooltest: %d jobs over %d connections match otp_local\n", jobCount, connectionCount);
+
+	free(text);
+	free(key);
+	free(result);
+	free(expected);
+
+	return 0;
+}
+
+
+/*
+ * Function Name: readText()
+ * Description: This function reads a text or key file into memory. It ends at its first newline, like
+ *		every text the clients read.
+ * Preconditions: none
+ * Postconditions: length holds the number of characters read, or the program has exited with an error
+ * Returns: the characters, which the caller frees
+*/
+char *readText(const char *fileName, size_t *length){
+	FILE *file = fopen(fileName, "r");
+	char *buffer = NULL;
+	char *newline = NULL;
+	size_t capacity = 65536;
+	size_t charsRead = 0;
+
+	if(file == NULL){
+		fprintf(stderr, "Error: could not open '%s'\n", fileName);
+		exit(1);
+	}
+
+	*length = 0;
+	buffer = malloc(capacity);
+	while(buffer != NULL && (charsRead = fread(buffer + *length, 1, capacity - *length, file)) > 0){
+		*length += charsRead;
+		if(*length == capacity){
+			capacity *= 2;
+			buffer = realloc(buffer, capacity);
+		}
+	}
+	if(buffer == NULL){
+		fprintf(stderr, "Error: out of memory\n");
+		exit(1);
+	}
+	fclose(file);
+
+	newline = memchr(buffer, '\n', *length);
+	if(newline != NULL){
+		*length = newline - buffer;
+	}
+
+	return buffer;
+}
+
+
+/*
+ * Function Name: runLocal()
+ * Description: This function runs a program and reads everything it prints to stdout.
+ * Preconditions: argv must end with NULL.
+ * Postconditions: length holds the number of bytes read, or the program has exited with an error if it
+ *		couldn't be run or didn't exit with 0
+ * Returns: what it printed, which the caller frees
+*/
+char *runLocal(const char *program, char *argv[], size_t *length){
+	int pipeFDs[2];
+	char *buffer = NULL;
+	size_t capacity = 65536;
+	ssize_t charsRead = 0;
+	pid_t child = -1;
+	int childStatus = 0;
+
+	if(pipe(pipeFDs) < 0 || (child = fork()) < 0){
+		perror("Error: could not run otp_local");
+		exit(1);
+	}
+
+	if(child == 0){
+		dup2(pipeFDs[1], STDOUT_FILENO);
+		close(pipeFDs[0]);
+		close(pipeFDs[1]);
+		execv(program, argv);
+		fprintf(stderr, "Error: could not run '%s'\n", program);
+		_exit(1);
+	}
+	close(pipeFDs[1]);
+
+	*length = 0;
+	buffer = malloc(capacity);
+	while(buffer != NULL && (charsRead = read(pipeFDs[0], buffer + *length, capacity - *length)) > 0){
+		*length += charsRead;
+		if(*length == capacity){
+			capacity *= 2;
+			buffer = realloc(buffer, capacity);
+		}
+	}
+	close(pipeFDs[0]);
+
+	if(buffer == NULL || charsRead < 0 || waitpid(child, &childStatus, 0) < 0 || !WIFEXITED(childStatus) || WEXITSTATUS(childStatus) != 0){
+		fprintf(stderr, "Error: otp_local failed\n");
+		exit(1);
+	}
+
+	return buffer;
+}
+
+
+/*
+ * Function Name: jobDone()
+ * Description: This function is every job's done function. It counts the jobs finished.
+ * Preconditions: The job's context must point at the count.
+ * Postconditions: The count has gone up by one
+ * Returns: none
+*/
+void jobDone(struct otpJob *job){
+	(*(int *)job->context)++;
+}
@@ -0,0 +1,274 @@
+/*
+ * Author: John Olgin
+ * Program Name: otp_protocol.h
+ * Date: 10/18/26
+ * Description: This header describes the wire protocol spoken between the otp_enc/otp_dec clients and
+ *	the otp_enc_d/otp_dec_d daemons, so every program packs and reads requests the same way.
+ *
+ *	A request is a fixed size header followed by its body:
+ *		magic (4 bytes), version (1), operation (1), flags (2), request id (4), payload length (8),
+ *		key length (8)
+ *	The body is the payload and key interleaved in chunks: up to CHUNK_SIZE payload characters, then
+ *	the same number of key characters, repeated until the whole payload is sent. The key length must
+ *	match the payload length. No newlines are sent.
+ *
+ *	If the OTP_FLAG_KEY_ID flag is set the key isn't sent at all. The daemon holds a directory of pads,
+ *	and the body starts with a key reference naming one of them instead:
+ *		offset (8 bytes), pad id (the rest, up to OTP_KEY_ID_MAX bytes)
+ *	The key length is the length of the reference, and the payload follows it in chunks of up to
+ *	CHUNK_SIZE with no key chunks in between. The key is the pad's characters starting at the offset.
+ *
+ *	The daemon answers every request with a fixed size header followed by exactly as many result
+ *	characters as the payload had:
+ *		magic (4 bytes), version (1), status (1), flags (2), request id (4), result length (8)
+ *	If the status isn't OTP_STATUS_OK no result follows and the daemon closes the connection.
+ *	Otherwise the connection stays open and the client may send another request on it.
+ *
+ *	If the OTP_FLAG_PACKED flag is set every payload and key chunk is sent packed, 5 bits to a character
+ *	and 8 characters to 5 bytes (see otpPack()), so a chunk of n characters takes OTP_PACKED_LENGTH(n)
+ *	bytes. The lengths in the header still count characters. A daemon that packs answers with the flag set
+ *	in its response, and sends its result chunks packed the same way. Since every chunk but the last holds
+ *	a multiple of 8 characters, the packed chunks of a payload are the same bytes as the whole payload
+ *	packed at once. A key reference is never packed.
+ *	A client finds out whether a daemon packs by sending an empty request with the flag set as the first
+ *	request on a connection. Only if the answer has the flag set does it send packed requests on that
+ *	connection. A daemon that doesn't know the flag answers an empty request without it.
+ *
+ *	A client doesn't have to wait for an answer before sending its next request. The daemon answers
+ *	the requests on a connection one at a time in the order they were sent, and copies each request's
+ *	id into its response so the client can check every answer belongs to the request it expects.
+ *
+ *	All numbers are sent in network byte order.
+*/
+
+#ifndef OTP_PROTOCOL_H
+#define OTP_PROTOCOL_H
+
+#include <stdint.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+
+#define OTP_MAGIC 0x4f545021
+#define OTP_VERSION 2
+
+#define OTP_REQUEST_HEADER_SIZE 28
+#define OTP_RESPONSE_HEADER_SIZE 20
+
+// the operations a request can ask for, each daemon only accepts its own
+#define OTP_OP_ENCRYPT 1
+#define OTP_OP_DECRYPT 2
+
+// the status a daemon answers with
+#define OTP_STATUS_OK 0
+#define OTP_STATUS_BAD_VERSION 1
+#define OTP_STATUS_WRONG_OPERATION 2
+#define OTP_STATUS_BAD_REQUEST 3
+#define OTP_STATUS_NO_KEY 4		// the referenced pad isn't held by the daemon, or is too short
+
+// the request flags
+#define OTP_FLAG_KEY_ID 1		// the key is a reference to a pad held by the daemon
+#define OTP_FLAG_PACKED 2		// the chunks each way are packed, 5 bits to a character
+
+// the longest pad id a key reference can hold, and the longest reference
+#define OTP_KEY_ID_MAX 255
+#define OTP_KEY_REFERENCE_MAX (8 + OTP_KEY_ID_MAX)
+
+// the largest piece of payload (and of key) sent before switching to the other
+#define CHUNK_SIZE 16384
+
+// a request header once it has been unpacked
+struct otpRequest {
+	uint32_t magic;
+	int version;
+	int operation;
+	int flags;
+	uint32_t requestId;
+	uint64_t payloadLength;
+	uint64_t keyLength;
+};
+
+// a response header once it has been unpacked
+struct otpResponse {
+	uint32_t magic;
+	int version;
+	int status;
+	int flags;
+	uint32_t requestId;
+	uint64_t length;
+};
+
+
+/*
+ * Function Name: packNumber()
+ * Description: This function writes the lowest count bytes of a number into a buffer, most
+ *		significant byte first.
+ * Preconditions: The buffer must hold at least count bytes.
+ * Postconditions: The buffer holds the number in network byte order
+ * Returns: none
+*/
+static inline void packNumber(unsigned char buffer[], uint64_t number, int count){
+	int i = 0;
+
+	for(i = count - 1; i >= 0; i--){
+		buffer[i] = number & 0xff;
+		number >>= 8;
+	}
+}
+
+
+/*
+ * Function Name: unpackNumber()
+ * Description: This function reads a count byte number written by packNumber().
+ * Preconditions: The buffer must hold at least count bytes.
+ * Postconditions: none
+ * Returns: the number
+*/
+static inline uint64_t unpackNumber(const unsigned char buffer[], int count){
+	uint64_t number = 0;
+	int i = 0;
+
+	for(i = 0; i < count; i++){
+		number = (number << 8) | buffer[i];
+	}
+
+	return number;
+}
+
+
+/*
+ * Function Name: packRequest()
+ * Description: This function lays a request header out in its wire format.
+ * Preconditions: The buffer must hold OTP_REQUEST_HEADER_SIZE bytes.
+ * Postconditions: The buffer is ready to be sent
+ * Returns: none
+*/
+static inline void packRequest(const struct otpRequest *request, unsigned char buffer[]){
+	packNumber(buffer, request->magic, 4);
+	packNumber(buffer + 4, request->version, 1);
+	packNumber(buffer + 5, request->operation, 1);
+	packNumber(buffer + 6, request->flags, 2);
+	packNumber(buffer + 8, request->requestId, 4);
+	packNumber(buffer + 12, request->payloadLength, 8);
+	packNumber(buffer + 20, request->keyLength, 8);
+}
+
+
+/*
+ * Function Name: unpackRequest()
+ * Description: This function reads a request header out of its wire format.
+ * Preconditions: The buffer must hold OTP_REQUEST_HEADER_SIZE received bytes.
+ * Postconditions: The request struct is filled in
+ * Returns: none
+*/
+static inline void unpackRequest(const unsigned char buffer[], struct otpRequest *request){
+	request->magic = unpackNumber(buffer, 4);
+	request->version = unpackNumber(buffer + 4, 1);
+	request->operation = unpackNumber(buffer + 5, 1);
+	request->flags = unpackNumber(buffer + 6, 2);
+	request->requestId = unpackNumber(buffer + 8, 4);
+	request->payloadLength = unpackNumber(buffer + 12, 8);
+	request->keyLength = unpackNumber(buffer + 20, 8);
+}
+
+
+/*
+ * Function Name: packResponse()
+ * Description: This function lays a response header out in its wire format.
+ * Preconditions: The buffer must hold OTP_RESPONSE_HEADER_SIZE bytes.
+ * Postconditions: The buffer is ready to be sent
+ * Returns: none
+*/
+static inline void packResponse(const struct otpResponse *response, unsigned char buffer[]){
+	packNumber(buffer, response->magic, 4);
+	packNumber(buffer + 4, response->version, 1);
+	packNumber(buffer + 5, response->status, 1);
+	packNumber(buffer + 6, response->flags, 2);
+	packNumber(buffer + 8, response->requestId, 4);
+	packNumber(buffer + 12, response->length, 8);
+}
+
+
+/*
+ * Function Name: unpackResponse()
+ * Description: This function reads a response header out of its wire format.
+ * Preconditions: The buffer must hold OTP_RESPONSE_HEADER_SIZE received bytes.
+ * Postconditions: The response struct is filled in
+ * Returns: none
+*/
+static inline void unpackResponse(const unsigned char buffer[], struct otpResponse *response){
+	response->magic = unpackNumber(buffer, 4);
+	response->version = unpackNumber(buffer + 4, 1);
+	response->status = unpackNumber(buffer + 5, 1);
+	response->flags = unpackNumber(buffer + 6, 2);
+	response->requestId = unpackNumber(buffer + 8, 4);
+	response->length = unpackNumber(buffer + 12, 8);
+}
+
+
+/*
+ * Function Name: packKeyReference()
+ * Description: This function lays a key reference out in its wire format.
+ * Preconditions: The id must be 1 to OTP_KEY_ID_MAX bytes long, and the buffer must hold
+ *		OTP_KEY_REFERENCE_MAX bytes.
+ * Postconditions: The buffer is ready to be sent
+ * Returns: the length of the reference, which is also the request's key length
+*/
+static inline size_t packKeyReference(const char *id, size_t idLength, uint64_t offset, unsigned char buffer[]){
+	packNumber(buffer, offset, 8);
+	memcpy(buffer + 8, id, idLength);
+
+	return 8 + idLength;
+}
+
+
+/*
+ * Function Name: sendAll()
+ * Description: This function keeps calling send() until every byte passed in has been sent.
+ * Preconditions: The socket must be a connected, blocking socket.
+ * Postconditions: All of the bytes have been handed to the kernel
+ * Returns: 0 on success, -1 on error
+*/
+static inline int sendAll(int socketFD, const void *buffer, size_t length, int flags){
+	size_t totalWritten = 0;
+	ssize_t charsWritten = -1;
+
+	while(totalWritten < length){
+		charsWritten = send(socketFD, (const char *)buffer + totalWritten, length - totalWritten, flags);
+		if(charsWritten < 0){
+			return -1;
+		}
+		totalWritten += charsWritten;
+	}
+
+	return 0;
+}
+
+
+/*
+ * Function Name: recvAll()
+ * Description: This function keeps calling recv() until exactly length bytes have arrived.
+ * Preconditions: The socket must be a connected, blocking socket.
+ * Postconditions: The buffer holds the bytes received
+ * Returns: the number of bytes received, which is less than length only if the other side hung up,
+ *		or -1 on error
+*/
+static inline ssize_t recvAll(int socketFD, void *buffer, size_t length){
+	size_t totalRead = 0;
+	ssize_t charsRead = -1;
+
+	while(totalRead < length){
+		charsRead = recv(socketFD, (char *)buffer + totalRead, length - totalRead, 0);
+		if(charsRead < 0){
+			return -1;
+		}
+		if(charsRead == 0){
+			break;
+		}
+		totalRead += charsRead;
+	}
+
+	return totalRead;
+}
+
+#endif